@@ -1,26 +1,34 @@
 #version 330 core // Set OpenGL version 3.3
 
 /*
- * This shader takes as input the pixel position of the vertices as measured 
- * when the board size is fixed to the values given by the totalWidth and 
- * totalHeight uniforms. Since OpenGL expects positions to be based on axes that
- * are located in the center of the window and constrained to range from +1 to -1, 
- * we need to first subtract the center pixel position from the inputs and then
- * divide the height/width by two times the totalWidth/totalHeight value. We also 
- * need to flip the direction of the pixel y-axis since it normally runs down the 
- * image. The texture coordinates are sent on to the fragment shader unmodified. 
+ * This shader draws every square of a frame from a single unit square using
+ * instancing. Each instance supplies a pixel rectangle and a texture rectangle,
+ * given by the positions and texture coordinates of two opposite corners, and
+ * the corner attribute of the unit square selects between the two edges of both 
+ * rectangles. The pixel positions are measured when the board size is fixed to 
+ * the values given by the totalWidth and totalHeight uniforms. Since OpenGL expects
+ * positions to be based on axes that are located in the center of the window and
+ * constrained to range from +1 to -1, we need to first subtract the center pixel 
+ * position from the inputs and then divide the height/width by two times the 
+ * totalWidth/totalHeight value. We also need to flip the direction of the pixel 
+ * y-axis since it normally runs down the image. The texture coordinates are sent 
+ * on to the fragment shader.
  */
 
-layout (location = 0) in vec2 pixelPos; // Physical positions of vertices given in pixels from top-left corner
-layout (location = 1) in vec2 texturePosIn; // Texture positions of vertices in range [0, 1] from bottom-left corner
+layout (location = 0) in vec2 corner; // Corner of the unit square, either 0 or 1 along each axis
+layout (location = 1) in vec4 pixelRect; // Pixel positions of two opposite corners, from top-left of the board
+layout (location = 2) in vec4 textureRect; // Texture positions of the same two corners, in range [0, 1]
 
-uniform float totalWidth; // Total width of the board at same pixel scale as pixelPos
-uniform float totalHeight; // Total height of the board at same pixel scale as pixelPos
+uniform float totalWidth; // Total width of the board at same pixel scale as pixelRect
+uniform float totalHeight; // Total height of the board at same pixel scale as pixelRect
 
-out vec2 texturePos; // Must have a different name than the input variable
+out vec2 texturePos;
 
 void main() {
 
+    // Stretch the unit square to the pixel and texture rectangles of this instance
+    vec2 pixelPos = mix(pixelRect.xy, pixelRect.zw, corner);
+
     // Calculate position of the center in "pixel space"
     float centerX = totalWidth * 0.5;
     float centerY = totalHeight * 0.5;
@@ -31,5 +39,5 @@ void main() {
 
     // Create outputs
     gl_Position = vec4(relX, relY, 0, 1.0);
-    texturePos = texturePosIn;
-};
\ No newline at end of file
+    texturePos = mix(textureRect.xy, textureRect.zw, corner);
+};
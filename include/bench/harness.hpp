@@ -0,0 +1,58 @@
+#ifndef HARNESS
+#define HARNESS
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+/*
+ * A minimal benchmark harness. A benchmark is a function that runs the
+ * operation being measured a given number of times. The harness calls it with
+ * growing counts until a run lasts long enough to time reliably, and reports
+ * the time per operation of that last run.
+ */
+
+struct BenchResult
+{
+    std::string name;
+    long iterations;
+    double nanoseconds; // Time per operation
+};
+
+template <typename T>
+inline void keepValue(const T& value)
+// This function stops the compiler from discarding the computation of a value that is otherwise unused.
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <typename Body>
+BenchResult runBenchmark(const std::string& name, Body&& body, double minSeconds = 0.2)
+/*
+ * This function times body(iterations), starting from one iteration and
+ * growing the count until a run takes at least minSeconds, then prints and
+ * returns the time per iteration of the final run.
+ */
+{
+    long iterations = 1;
+    double seconds = 0;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds >= minSeconds) {
+            break;
+        }
+        // Aim a little past the target, without growing more than tenfold from a very short run.
+        double scale = (seconds > 0) ? 1.2*minSeconds/seconds : 10;
+        iterations = static_cast<long>(iterations * ((scale < 10) ? ((scale > 1.5) ? scale : 1.5) : 10)) + 1;
+    }
+    BenchResult result{name, iterations, 1e9*seconds/iterations};
+    std::cout << std::left << std::setw(48) << name << std::right << std::setw(14) << iterations
+        << std::setw(14) << std::fixed << std::setprecision(2) << result.nanoseconds << " ns" << std::endl;
+    return result;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ARCHIVE
+#define ARCHIVE
+
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+
+struct ArchiveEntry
+{
+    uint64_t gameId;
+    uint64_t offset;
+    uint32_t replayLength;
+    uint32_t checkpointCount;
+    uint32_t frames;
+    uint32_t score;
+    uint32_t lines;
+    uint32_t lineTypeCount[4];
+    uint32_t reserved[3];
+};
+
+struct CheckpointEntry
+{
+    uint32_t frame;
+    uint32_t size;
+    uint64_t offset;
+};
+
+struct ArchiveCheckpoint
+{
+    uint32_t frame;
+    std::vector<uint8_t> data;
+};
+
+struct ArchiveTrailer
+{
+    uint64_t indexOffset;
+    uint64_t count;
+    char magic[8];
+};
+
+static_assert(sizeof(ArchiveEntry) == 64, "ArchiveEntry is read directly from the file");
+static_assert(sizeof(CheckpointEntry) == 16, "CheckpointEntry is read directly from the file");
+static_assert(sizeof(ArchiveTrailer) == 24, "ArchiveTrailer is read directly from the file");
+
+ArchiveCheckpoint makeCheckpoint(uint32_t frame, const NESTetris& game);
+
+class ArchiveWriter
+{
+    public:
+
+    ArchiveWriter(const std::string& filePath);
+    ~ArchiveWriter();
+    bool isOpen() const;
+    size_t size() const;
+    bool addGame(uint64_t gameId, const std::vector<uint8_t>& replay, const NESTetris& game,
+        const std::vector<ArchiveCheckpoint>& checkpoints);
+    bool close();
+
+    private:
+
+    std::string filePath;
+    std::ofstream file;
+    uint64_t endOffset;
+    std::vector<ArchiveEntry> index;
+    std::unordered_set<uint64_t> gameIds;
+
+    void writePadded(const void* data, size_t size);
+};
+
+class ArchiveReader
+{
+    public:
+
+    ArchiveReader(const std::string& filePath);
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+    ~ArchiveReader();
+    bool isOpen() const;
+    size_t size() const;
+    const ArchiveEntry* getEntry(size_t position) const;
+    const ArchiveEntry* findGame(uint64_t gameId) const;
+    InputReplayer getReplay(const ArchiveEntry& entry) const;
+    const CheckpointEntry* findCheckpoint(const ArchiveEntry& entry, uint32_t frame) const;
+    const uint8_t* getCheckpointData(const CheckpointEntry& checkpoint) const;
+    uint32_t seekGame(const ArchiveEntry& entry, uint32_t frame, NESTetris& game) const;
+
+    private:
+
+    const uint8_t* base;
+    size_t length;
+    const ArchiveEntry* index;
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef BATCHNES
+#define BATCHNES
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+#include "game/environment.hpp"
+#include "game/threadpool.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * Each board of a BatchNES is stored as batchRows occupancy masks, with
+ * batchFloorRows solid rows below the playfield and the rest of the rows above
+ * it holding only the walls. The columns of a row are shifted up by
+ * batchWallBits, and the bits on either side of them are always set, so that a
+ * piece overlapping a wall or the floor is found by the same test as one
+ * overlapping the stack.
+ */
+constexpr int batchRows = 32, batchFloorRows = 4, batchWallBits = 3;
+constexpr uint16_t batchFullRow = 0xFFFF, batchEmptyRow = batchFullRow & ~(((1u << 10) - 1) << batchWallBits);
+
+class BatchNES
+{
+    public:
+
+    int numGames;
+    int startLevel;
+    int firstThreshold;
+    RandomMode mode;
+    NESConstants constants;
+    ThreadPool* pool;
+
+    // Per-game state, indexed by game (boards by game*batchRows + batchFloorRows + row)
+    std::vector<uint16_t> boards;
+    std::vector<uint8_t> phase, piece, nextPiece, orient;
+    std::vector<int8_t> pieceRow, pieceCol;
+    std::vector<uint8_t> dropDelay, dropFrames, dasFrames, frozenFrames, clearFrames, entryDelay;
+    std::vector<uint8_t> setGravity, prevButtons, commands;
+    std::vector<int32_t> level, lineCount, score, move, totalFrames;
+    std::vector<int32_t> lineTypeCount; // Indexed by type*numGames + game
+    std::vector<PieceGenerator> generators;
+
+    BatchNES(int numGames, int startLevel, RandomMode mode);
+    void usePool(ThreadPool& pool);
+    void reset(int game, uint32_t seed);
+    void resetAll(const uint32_t* seeds);
+    void step(const uint8_t* buttons, float* rewards, uint8_t* dones);
+    void stepCommands(const uint8_t* packedCommands, float* rewards, uint8_t* dones);
+    void observe(uint8_t* observations) const;
+
+    private:
+
+    std::vector<uint8_t> wasActive, drops;
+
+    void runStep(const uint8_t* inputs, bool buttons, float* rewards, uint8_t* dones);
+    void stepRange(int begin, int end, const uint8_t* inputs, bool buttons, float* rewards, uint8_t* dones);
+    bool collides(int game, int newOrient, int row, int col) const;
+    void movePiece(int game);
+    void lockPiece(int game, float& reward);
+    void spawnPiece(int game);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef BOT
+#define BOT
+
+#include "game/nes.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/threadpool.hpp"
+#include "game/transposition.hpp"
+
+#include <vector>
+#include <cstdint>
+
+class BotPlayer
+{
+    public:
+
+    EvalWeights weights;
+    InputModel input;
+    ThreadPool* pool;
+    double budget;
+    TranspositionTable* table;
+    long evaluations, tableHits;
+
+    BotPlayer(const EvalWeights& weights, const InputModel& input);
+    void setCommands(NESTetris& game);
+    void useLookahead(ThreadPool& pool, double budget);
+    void useTable(TranspositionTable& table);
+    void reset();
+
+    private:
+
+    std::vector<TimedPlacement> placements;
+    std::vector<uint8_t> plan;
+    int planStep, plannedMove, expectedFrame;
+
+    void choosePlacement(const NESTetris& game);
+};
+
+#endif
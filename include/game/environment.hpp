@@ -0,0 +1,100 @@
+#ifndef ENVIRONMENT
+#define ENVIRONMENT
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+#include "game/reach.hpp"
+#include "game/evaluate.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * Layout of an observation, as bytes in the buffer passed to NESEnvironment.
+ * The two planes hold one byte per cell of the 20 x 10 board, row by row from
+ * the bottom, set to 1 for a locked block (stack plane) or a block of the
+ * falling piece (piece plane). They are followed by the scalars listed below.
+ */
+constexpr int observationCells = 20*10;
+constexpr int stackPlane = 0, piecePlane = observationCells, scalarOffset = 2*observationCells;
+
+enum ObservationScalar : int
+{
+    obsPiece, // Index of the current piece
+    obsNextPiece, // Index of the next piece
+    obsLevel, // Current level
+    obsGravity, // Frames between drops at this level, less one (as in NESConstants::setGravity)
+    obsDropFrames, // Frames since the piece last dropped
+    obsDasFrames, // DAS counter
+    obsPieceRow, // Row of the center of the current piece
+    obsPieceCol, // Column of the center of the current piece
+    obsPieceOrient, // Orientation of the current piece
+    obsPhase, // What the game is doing this frame (one of the EnvironmentPhase values)
+    obsScalarCount
+};
+
+constexpr int observationSize = scalarOffset + obsScalarCount;
+
+enum EnvironmentPhase : uint8_t
+{
+    phaseActive, // A piece is falling and reads the controller
+    phaseEntryDelay, // The game is paused after a piece locks
+    phaseLineClear, // The game is paused for the line clear animation
+    phaseGameOver // The game has topped out
+};
+
+// Bits of the controller buttons held on a frame, as passed to NESEnvironment::step.
+enum ControllerButton : uint8_t
+{
+    buttonLeft = 1 << 0,
+    buttonRight = 1 << 1,
+    buttonDown = 1 << 2,
+    buttonA = 1 << 3, // Rotate counterclockwise
+    buttonB = 1 << 4 // Rotate clockwise
+};
+
+struct StepInfo
+{
+    int lines; // Lines cleared during the step
+    int frames; // Frames run during the step
+    bool locked; // Whether a piece locked during the step
+};
+
+struct StepResult
+{
+    float reward;
+    bool done;
+    StepInfo info;
+};
+
+class NESEnvironment
+{
+    public:
+
+    NESTetris game;
+    InputModel input;
+
+    NESEnvironment(int startLevel, RandomMode mode, uint8_t* observation);
+    const uint8_t* reset(uint32_t seed);
+    StepResult step(uint8_t buttons);
+    StepResult stepPlacement(int placement);
+    const std::vector<TimedPlacement>& getPlacements();
+
+    private:
+
+    uint8_t* observation;
+    uint8_t prevButtons;
+    int spawnFrame;
+    int placementsFrame;
+    StackRows shownRows;
+    PieceCoords shownPiece;
+    bool pieceShown;
+    std::vector<TimedPlacement> placements;
+
+    void runFrame(const NESCommands& commands, StepResult& result);
+    void skipToPiece(StepResult& result);
+    void writeObservation();
+    uint8_t getPhase() const;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef EVALUATE
+#define EVALUATE
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+
+#include <map>
+#include <string>
+#include <array>
+#include <cstdint>
+
+// The occupancy masks of a stack, indexed from the bottom as in Grid::rows.
+using StackRows = std::array<uint16_t, Grid::maxHeight>;
+
+/*
+ * The BoardFeatures struct holds the measurements of a stack that are weighed
+ * by the evaluation function. Column heights count from the floor up to the
+ * highest filled block of the column.
+ */
+struct BoardFeatures
+{
+    int holes; // Empty blocks with a filled block somewhere above them in the same column
+    int bumpiness; // Sum of the height differences between neighboring columns
+    int wellDepth; // Sum over columns of how far each one sits below both of its neighbors (walls count as full)
+    int aggregateHeight; // Sum of the column heights
+    int maxHeight; // Height of the tallest column
+    int unfitPieces; // Number of piece types whose bottom contour does not match the surface anywhere
+    int linesCleared; // Number of lines cleared by the placement that produced the stack
+};
+
+/*
+ * The EvalWeights struct holds the weight of each feature, with the score of
+ * a stack being the weighted sum of its features. Features that make a stack
+ * worse should have negative weights. Line clears have one weight per type,
+ * since a Tetris is worth far more than four singles.
+ */
+struct EvalWeights
+{
+    double holes, bumpiness, wellDepth, aggregateHeight, maxHeight, unfitPieces;
+    double singles, doubles, triples, tetrises;
+};
+
+EvalWeights defaultWeights();
+bool loadWeights(const std::string& filePath, EvalWeights& weights);
+int placeOnStack(const Grid& grid, const PieceData& data, const Placement& placement, StackRows& rows);
+BoardFeatures getFeatures(const StackRows& rows, int height, int width, int linesCleared);
+double scoreLines(int linesCleared, const EvalWeights& weights);
+double scoreFeatures(const BoardFeatures& features, const EvalWeights& weights);
+double evaluatePlacement(const Grid& grid, const PieceData& data, const Placement& placement,
+    const EvalWeights& weights);
+
+extern const std::map<const std::string, double EvalWeights::*> weightNames;
+
+#endif
@@ -2,23 +2,42 @@
 #define GRID
 
 #include <vector>
+#include <array>
+#include <cstdint>
+
+/*
+ * The (row, col) coordinate of one block. It is a plain struct rather than a
+ * std::pair, whose assignment operators are user-provided, so that the pieces
+ * and grids built from it stay trivially copyable.
+ */
+struct BlockCoord
+{
+    int8_t first, second;
+};
+
+using PieceCoords = std::array<BlockCoord, 4>;
 
 class Grid
 {
     public: 
     
+    static constexpr int maxHeight = 32, maxWidth = 16;
     int height, width;
-    std::vector<std::vector<int>> grid;
+    uint16_t fullRow;
+    std::array<uint16_t, maxHeight> rows;
+    std::array<uint8_t, maxHeight*maxWidth> colors;
 
     Grid(const int height, const int width);
-    bool collisionCheck(const std::vector<std::vector<int>>& coords);
-    void fillSet(const std::vector<std::vector<int>>& coords, unsigned int index);
+    bool collisionCheck(const PieceCoords& coords) const;
+    bool collisionCheck(int bottomRow, const std::array<uint16_t, 4>& rowMasks) const;
+    void fillSet(const PieceCoords& coords, unsigned int index);
     void fill(int row, int col, unsigned int index);
-    int get(const int row, const int col);
+    int get(const int row, const int col) const;
+    uint16_t getRow(const int row) const;
     void clearRows(std::vector<int> filledRows);
-    bool inBounds(const int row, const int col);
-    std::vector<std::vector<int>> getFilledBlocks();
-    std::vector<int> getFilledRows();
+    bool inBounds(const int row, const int col) const;
+    std::vector<std::vector<int>> getFilledBlocks() const;
+    std::vector<int> getFilledRows() const;
     void clear();
 };
 
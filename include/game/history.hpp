@@ -0,0 +1,53 @@
+#ifndef HISTORY
+#define HISTORY
+
+#include "game/board.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <cstdint>
+
+struct MoveRecord
+{
+    uint8_t index;
+    int8_t centerRow, centerCol;
+    uint8_t orient;
+};
+
+struct MoveNode
+{
+    MoveRecord move;
+    int parent;
+    int firstChild;
+    int nextSibling;
+    int activeChild;
+    int depth;
+    int keyframe;
+};
+
+class MoveHistory
+{
+    public:
+
+    int current;
+
+    MoveHistory(const Board& startBoard, int keyframeInterval);
+    void reset(const Board& startBoard);
+    void push(const Piece& piece, const Board& result);
+    bool back();
+    bool forward();
+    bool switchVariation(int step);
+    int size() const;
+    int getDepth(int node) const;
+    int getVariationCount(int node) const;
+    Board getBoard(int node) const;
+    Piece getPiece(int node) const;
+
+    private:
+
+    int keyframeInterval;
+    std::vector<MoveNode> nodes;
+    std::vector<Board> keyframes;
+};
+
+#endif
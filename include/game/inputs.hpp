@@ -1,6 +1,8 @@
 #ifndef INPUTS
 #define INPUTS
 
+#include "game/inputsource.hpp"
+
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 
@@ -9,14 +11,14 @@
 #include <string>
 
 
-class InputHandler
+class InputHandler : public InputSource
 {
     public:
 
     InputHandler(GLFWwindow* window);
-    std::map<const std::string, std::string> getStates(std::vector<std::string> keyName);
-    std::vector<double> getMousePos();
-    std::vector<int> getWindowSize();
+    std::map<const std::string, std::string> getStates(std::vector<std::string> keyName) override;
+    std::vector<double> getMousePos() override;
+    std::vector<int> getWindowSize() override;
     static void keyCallBack(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void mousePosCallBack(GLFWwindow* window, double xpos, double ypos);
     static void mouseClickCallBack(GLFWwindow* window, int button, int action, int mods);
@@ -0,0 +1,18 @@
+#ifndef INPUTSOURCE
+#define INPUTSOURCE
+
+#include <vector>
+#include <map>
+#include <string>
+
+class InputSource
+{
+    public:
+
+    virtual ~InputSource() = default;
+    virtual std::map<const std::string, std::string> getStates(std::vector<std::string> keyNames) = 0;
+    virtual std::vector<double> getMousePos() = 0;
+    virtual std::vector<int> getWindowSize() = 0;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef LOOKAHEAD
+#define LOOKAHEAD
+
+#include "game/nes.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/threadpool.hpp"
+#include "game/transposition.hpp"
+
+#include <vector>
+#include <chrono>
+
+struct LookaheadStats
+{
+    int searched; // Placements of the current piece whose follow-ups were all scored
+    long leaves; // Positions of both pieces that were scored
+    long tableHits; // Placements whose follow-ups were found in the transposition table
+    double seconds; // Time taken by the search
+};
+
+int searchLookahead(const NESTetris& game, const std::vector<TimedPlacement>& placements,
+    const EvalWeights& weights, const InputModel& input, ThreadPool& pool,
+    std::chrono::steady_clock::time_point deadline, TranspositionTable* table, LookaheadStats& stats);
+
+#endif
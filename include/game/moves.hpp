@@ -0,0 +1,34 @@
+#ifndef MOVES
+#define MOVES
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+/*
+ * A Placement is a resting position of a piece: its orientation and the
+ * column and row of its center, as passed to Piece::setPosition.
+ */
+struct Placement
+{
+    int8_t orient, col, row;
+};
+
+// Every piece enters the playfield with its center here, in orientation 0.
+constexpr int spawnRow = 19, spawnCol = 5;
+
+/*
+ * A FitTable holds, for every center row from the floor up to the spawn row,
+ * one 16-bit lane per orientation in which bit col is set if the piece fits
+ * with its center at (row, col).
+ */
+using FitTable = std::array<uint64_t, spawnRow + 1>;
+
+void fillFitTable(const Grid& grid, const PieceData& data, FitTable& fits);
+int findPlacements(const Grid& grid, const PieceData& data, std::vector<Placement>& placements);
+Piece getPlacedPiece(const PieceData& data, const Placement& placement);
+
+#endif
@@ -3,33 +3,85 @@
 
 #include "game/pieces.hpp"
 #include "game/grid.hpp"
-#include "game/inputs.hpp"
+#include "game/inputsource.hpp"
 #include "game/board.hpp"
 
 #include <map>
 #include <string>
 #include <vector>
-#include <memory>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+struct NESCommands
+{
+    bool doCCW, doCW, doLeft, doRight, softDrop, leftDAS, rightDAS, reset;
+};
+
+struct NESFlags
+{
+    bool frozen, dropDelay, gameOver;
+};
+
+struct NESConstants
+{
+    int dasLimit, dasFloor, firstDelay, height, width, setGravity;
+};
+
+struct NESDynamic
+{
+    int dropFrames, gravity, dasFrames, frozenFrames, clearFrames, totalFrames, move, score, level, entryDelay;
+};
+
+/*
+ * The complete state of an NESTetris game (everything except the input source)
+ * as a fixed-size block of plain data, which can be copied, compared, or written
+ * to disk directly. The grids are stored as 4-bit cells, two per byte.
+ */
+constexpr int snapshotCells = 20*10;
+
+struct NESSnapshot
+{
+    int32_t startLevel, firstThreshold;
+    NESCommands commands;
+    NESFlags flags;
+    NESConstants constants;
+    NESDynamic dynamic;
+    int32_t lineScore[4];
+    int32_t lineCount, lineTypeCount[4];
+    int8_t filledRows[4];
+    uint8_t numFilledRows;
+    uint8_t currIndex, nextIndex;
+    int8_t currRow, currCol, currOrient;
+    GeneratorState generator;
+    std::array<uint8_t, snapshotCells/2> boardCells, displayCells;
+};
+
+static_assert(std::is_trivially_copyable<NESSnapshot>::value, "NESSnapshot must be plain data");
 
 struct NESTetris
 {
     int startLevel;
     int firstThreshold;
-    std::map<const std::string, bool> commands, flags;
-    std::map<const std::string, int> constants, dynamic;
+    NESCommands commands;
+    NESConstants constants;
+    NESDynamic dynamic;
+    NESFlags flags;
     std::vector<int> filledRows;
     std::vector<int> lineScore;
-    std::vector<std::string> pieceSeq;
-    std::unique_ptr<Piece> currPiece, nextPiece;
-    InputHandler* inputPtr;
+    Piece currPiece, nextPiece;
+    InputSource* inputPtr;
     Board board;
     Grid displayGrid;
     PieceGenerator pieceGen;
 
+    NESTetris(int startLevel, PieceGenerator pieceGen);
     NESTetris(int startLevel);
+    NESTetris(int startLevel, uint32_t seed, RandomMode mode);
     void setConstants(int level);
     void setCommands();
     void runFrame();
+    void runFrame(const NESCommands& frameCommands);
     void runActiveFrame();
     void runFrozenFrame();
     void runClearFrame();
@@ -40,10 +92,20 @@ struct NESTetris
     void setEntryDelay();
     void checkLevel();
     void resetGame();
-    void assignInput(InputHandler& inputSource);
+    void assignInput(InputSource& inputSource);
+    NESSnapshot snapshot() const;
+    void restore(const NESSnapshot& state);
+    int* getInt(const std::string& name);
+    bool* getBool(const std::string& name);
 };
 
-void resetBool(std::map<const std::string, bool>& flags);
+NESConstants getLevelConstants(int level);
+int getEntryDelay(int row);
+
+extern const std::map<const std::string, bool NESCommands::*> commandNames;
+extern const std::map<const std::string, bool NESFlags::*> flagNames;
+extern const std::map<const std::string, int NESConstants::*> constantNames;
+extern const std::map<const std::string, int NESDynamic::*> dynamicNames;
 
 
 #endif
\ No newline at end of file
@@ -1,39 +1,105 @@
 #ifndef PIECES
 #define PIECES
 
+#include "game/grid.hpp"
+
 #include <vector>
+#include <array>
 #include <string>
 #include <map>
 #include <random>
-#include <memory>
+#include <type_traits>
+#include <cstdint>
+
+/*
+ * A Contour holds a variable-length list of surface steps (see bottomSurf
+ * below) in a fixed-size array, with the number of valid steps in length.
+ */
+struct Contour
+{
+    uint8_t length;
+    std::array<int8_t, 4> steps;
+};
+
+/*
+ * A BoundingBox gives the smallest and largest row and column offsets of
+ * a piece in one orientation, relative to its center.
+ */
+struct BoundingBox
+{
+    int8_t minRow, maxRow, minCol, maxCol;
+};
 
+/*
+ * The PieceData struct holds all of the information that characterizes a
+ * piece, as described below. One instance is created for each piece type
+ * in the constexpr pieceTable, with all of the different instances of the
+ * Piece class pointing to one of them. All arrays are indexed first by
+ * orientation, with unused orientations left as zeros.
+ */
 struct PieceData
 {
-    std::string name;
-    const unsigned int index;
-    const int numOrients;
-    std::vector<std::vector<std::vector<int>>> coordOffsets;
-    std::vector<std::vector<int>> bottomSurf, topSurf, sideHeights;
-
-    PieceData();
-    PieceData(
-        std::string name,
-        const unsigned int index,
-        const int numOrients,
-        std::vector<std::vector<std::vector<int>>> coordOffsets,
-        std::vector<std::vector<int>> bottomSurf,
-        std::vector<std::vector<int>> topSurf,
-        std::vector<std::vector<int>> sideHeights
-    );
+    /*
+     * The name of the piece, used as an identifier when reading or writing piece
+     * sequences. The engine itself only ever refers to pieces by their index.
+     */
+    const char* name;
+
+    /*
+     * The index is how the type of piece is specified on a Grid object and in
+     * the pieceTable, since the name is impractical to store directly.
+     */
+    unsigned int index;
+
+    // numOrients is simply the number of ways that a piece can be rotated.
+    int numOrients;
+
+    /*
+     * The coordOffsets describe the full shape of the piece. Each (row, col) pair
+     * describes the location of a piece block relative to the "center". During play
+     * the "center" is assigned a (row, col) coordinate, and piece blocks are then
+     * built around it by adding the offset to that coordinate.
+     */
+    std::array<PieceCoords, 4> coordOffsets;
+
+    /*
+     * bottomSurf describes the contour of the bottom of the piece using a set of
+     * integers that denote how much the higher a given block is relative to the
+     * block next to it. For example, the square piece has a flat bottom and therefore
+     * its contour is represented by 0, while the z-piece has a step shape represented
+     * by 1. These contours are used to determine whether a given piece will fit cleanly
+     * onto an existing stack of pieces. topSurf is the same except that it describes
+     * the contour of the top of the piece instead of the bottom.
+     */
+    std::array<Contour, 4> bottomSurf, topSurf;
+
+    /*
+     * sideHeights describes how much the edges of a piece alter the contour of the
+     * surface it is placed on. For example, the square piece is two blocks tall, so
+     * its left side height is 2 (two blocks heigher than the block to its left) and
+     * its right side height it -2 (the surface contour drops by two after the piece).
+     */
+    std::array<std::array<int8_t, 2>, 4> sideHeights;
+
+    // The bounding box of the piece, derived from coordOffsets.
+    std::array<BoundingBox, 4> bounds;
+
+    /*
+     * rowMasks holds the occupancy mask of each row of the piece, from the bottom
+     * row of its bounding box upwards, with bit 0 marking the leftmost column of
+     * the bounding box. Shifting the masks left by the column of the box's left
+     * edge gives the masks expected by the bitboard Grid::collisionCheck.
+     */
+    std::array<std::array<uint16_t, 4>, 4> rowMasks;
 };
 
 class Piece
 {
     public:
     
-    const PieceData& data;
+    const PieceData* data;
     int centerRow, centerCol, orient;
-    std::vector<std::vector<int>> coords;
+    PieceCoords coords;
 
     Piece();
     Piece(const PieceData& data);
@@ -42,23 +108,226 @@ class Piece
     void translate(int dRow, int dCol);
 };
 
+static_assert(std::is_trivially_copyable<Piece>::value, "Piece must be plain data");
+
+/*
+ * The two ways that a PieceGenerator can choose pieces: the dice procedure
+ * described in pieces.cpp, or an emulation of the linear-feedback shift
+ * register used by the NES cartridge.
+ */
+enum class RandomMode : uint8_t
+{
+    dice,
+    nesLFSR
+};
+
+// The largest number of upcoming pieces that a PieceGenerator can queue.
+constexpr int maxLookahead = 8;
+
+/*
+ * The complete state of a PieceGenerator, including its queue of upcoming
+ * pieces, which can be saved and later restored to continue the exact same
+ * sequence.
+ */
+struct GeneratorState
+{
+    std::array<uint8_t, maxLookahead> queue; // Ring buffer of upcoming piece indices
+    uint8_t queueHead; // Position of the oldest queued piece in the ring buffer
+    uint8_t lookahead; // Number of queued pieces
+    uint32_t engine; // State of the linear congruential engine used by the dice
+    uint16_t lfsr; // State of the NES shift register
+    uint8_t spawnCount; // Number of pieces chosen by the NES procedure (wraps)
+    uint8_t spawnID; // NES orientation ID of the last piece chosen
+    int8_t prevChoice; // Position in the piece list of the last piece chosen by the dice
+    RandomMode mode;
+};
+
 class PieceGenerator
 {
     public:
 
     PieceGenerator(std::vector<std::string> pieceList);
-    std::unique_ptr<Piece> getPiece(std::string pieceName);
-    std::vector<std::string> getRandomSequence(int length);
+    PieceGenerator(std::vector<std::string> pieceList, uint32_t seed, RandomMode mode);
+    Piece getPiece(unsigned int index);
+    Piece getPiece(const std::string& pieceName);
+    std::vector<uint8_t> getRandomSequence(int length);
+    uint8_t nextIndex();
+    void restartStream();
+    void setLookahead(int lookahead);
+    uint8_t next();
+    uint8_t peek(int ahead) const;
+    void advanceFrame();
+    void seed(uint32_t seed);
+    void setMode(RandomMode mode);
+    GeneratorState getState() const;
+    void setState(const GeneratorState& state);
 
     private:
 
-    std::vector<std::string> pieceList;
-    std::default_random_engine rEng;
-    std::uniform_int_distribution<int> uDistrNp1;
-    std::uniform_int_distribution<int> uDistrN;
+    std::vector<uint8_t> pieceList;
+    RandomMode mode;
+    std::array<uint8_t, maxLookahead> queue;
+    int queueHead, lookahead;
+    uint32_t engine;
+    uint16_t lfsr;
+    uint8_t spawnCount, spawnID;
+    int prevChoice;
+
+    uint32_t stepEngine();
+    int rollDie(int sides);
+    void stepLFSR();
+    uint8_t nextDiceIndex();
+    uint8_t nextNESIndex();
 };
 
-extern const std::map<const std::string, PieceData> allPieces;
-extern const PieceData nullPiece;
+constexpr PieceData makePieceData(
+    const char* name,
+    unsigned int index,
+    int numOrients,
+    std::array<PieceCoords, 4> coordOffsets,
+    std::array<Contour, 4> bottomSurf,
+    std::array<Contour, 4> topSurf,
+    std::array<std::array<int8_t, 2>, 4> sideHeights)
+/*
+ * This function builds a PieceData entry from the hand-written shape and
+ * contour data, deriving the bounding boxes and row masks of each orientation
+ * from the coordinate offsets. It is evaluated at compile time.
+ */
+{
+    PieceData data{name, index, numOrients, coordOffsets, bottomSurf, topSurf, sideHeights, {}, {}};
+    for (int orient = 0; orient < numOrients; ++orient) {
+        BoundingBox box{coordOffsets[orient][0].first, coordOffsets[orient][0].first,
+            coordOffsets[orient][0].second, coordOffsets[orient][0].second};
+        for (const auto& rowCol : coordOffsets[orient]) {
+            if (rowCol.first < box.minRow) box.minRow = rowCol.first;
+            if (rowCol.first > box.maxRow) box.maxRow = rowCol.first;
+            if (rowCol.second < box.minCol) box.minCol = rowCol.second;
+            if (rowCol.second > box.maxCol) box.maxCol = rowCol.second;
+        }
+        data.bounds[orient] = box;
+        for (const auto& rowCol : coordOffsets[orient]) {
+            data.rowMasks[orient][rowCol.first - box.minRow] |= (1u << (rowCol.second - box.minCol));
+        }
+    }
+    return data;
+}
+
+/*
+ * The master piece table, which holds the PieceData of every piece indexed by
+ * its piece index. Index 0 is the null piece, used as a default when a
+ * non-existent piece is requested.
+ */
+inline constexpr std::array<PieceData, 8> pieceTable{{
+    makePieceData(
+        "",
+        0, // Index
+        1, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, 0}, {0, 0}, {0, 0}}}}},
+        // Bottom Surface
+        {{{0, {}}}},
+        // Top Surface
+        {{{0, {}}}},
+        // Side Heights
+        {{{1, -1}}}),
+    makePieceData(
+        "lPiece",
+        1, // Index
+        4, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, 1}, {0, -1}, {-1, -1}}},
+        {{{0, 0}, {-1, 0}, {1, 0}, {1, -1}}},
+        {{{0, 0}, {0, -1}, {0, 1}, {1, 1}}},
+        {{{0, 0}, {1, 0}, {-1, 0}, {-1, 1}}}}},
+        // Bottom Surface
+        {{{2, {1, 0}}, {1, {-2}}, {2, {0, 0}}, {1, {0}}}},
+        // Top Surface
+        {{{2, {0, 0}}, {1, {0}}, {2, {0, 1}}, {1, {-2}}}},
+        // Side Heights
+        {{{2, -1}, {1, -3}, {1, -2}, {3, -1}}}),
+    makePieceData(
+        "jPiece",
+        2, // Index
+        4, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, -1}, {0, 1}, {-1, 1}}},
+        {{{0, 0}, {1, 0}, {-1, 0}, {-1, -1}}},
+        {{{0, 0}, {0, 1}, {0, -1}, {1, -1}}},
+        {{{0, 0}, {-1, 0}, {1, 0}, {1, 1}}}}},
+        // Bottom Surface
+        {{{2, {0, -1}}, {1, {0}}, {2, {0, 0}}, {1, {2}}}},
+        // Top surface
+        {{{2, {0, 0}}, {1, {2}}, {2, {-1, 0}}, {1, {0}}}},
+        // Side Heights
+        {{{1, -2}, {1, -3}, {2, -1}, {3, -1}}}),
+    makePieceData(
+        "sPiece",
+        3, // Index
+        2, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, 1}, {-1, -1}, {-1, 0}}},
+        {{{0, 0}, {1, 0}, {0, 1}, {-1, 1}}}}},
+        // Bottom Surface
+        {{{2, {0, 1}}, {1, {-1}}}},
+        // Top Surface
+        {{{2, {1, 0}}, {1, {-1}}}},
+        // Side Heights
+        {{{1, -1}, {2, -2}}}),
+    makePieceData(
+        "zPiece",
+        4, // Index
+        2, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, -1}, {-1, 0}, {-1, 1}}},
+        {{{0, 0}, {-1, 0}, {0, 1}, {1, 1}}}}},
+        // Bottom Surface
+        {{{2, {-1, 0}}, {1, {1}}}},
+        // Top Surface
+        {{{2, {0, -1}}, {1, {1}}}},
+        // Side Heights
+        {{{1, -1}, {2, -2}}}),
+    makePieceData(
+        "iPiece",
+        5, // Index
+        2, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {0, -2}, {0, -1}, {0, 1}}},
+        {{{0, 0}, {2, 0}, {1, 0}, {-1, 0}}}}},
+        // Bottom Surface
+        {{{4, {0, 0, 0, 0}}, {0, {}}}},
+        // Top Surface
+        {{{4, {0, 0, 0, 0}}, {0, {}}}},
+        // Side Heights
+        {{{1, -1}, {4, -4}}}),
+    makePieceData(
+        "tPiece",
+        6, // Index
+        4, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {-1, 0}, {0, 1}, {0, -1}}},
+        {{{0, 0}, {0, -1}, {-1, 0}, {1, 0}}},
+        {{{0, 0}, {1, 0}, {0, -1}, {0, 1}}},
+        {{{0, 0}, {0, 1}, {1, 0}, {-1, 0}}}}},
+        // Bottom Surface
+        {{{2, {-1, 1}}, {1, {-1}}, {2, {0, 0}}, {1, {1}}}},
+        // Top Surface
+        {{{2, {0, 0}}, {1, {1}}, {2, {1, -1}}, {1, {-1}}}},
+        // Side Heights
+        {{{1, -1}, {1, -3}, {1, -1}, {3, -1}}}),
+    makePieceData(
+        "sqPiece",
+        7, // Index
+        1, // Number of orientations
+        // Offsets from center
+        {{{{{0, 0}, {-1, 0}, {-1, -1}, {0, -1}}}}},
+        // Bottom Surface
+        {{{1, {0}}}},
+        // Top Surface
+        {{{1, {0}}}},
+        // Side Heights
+        {{{2, -2}}})
+}};
+
+unsigned int getPieceIndex(const std::string& pieceName);
 
 #endif
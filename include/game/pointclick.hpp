@@ -4,12 +4,12 @@
 #include "game/pieces.hpp"
 #include "game/grid.hpp"
 #include "game/board.hpp"
-#include "game/inputs.hpp"
+#include "game/inputsource.hpp"
+#include "game/history.hpp"
 
 #include <map>
 #include <string>
 #include <vector>
-#include <memory>
 
 struct PointClick
 {
@@ -21,10 +21,10 @@ struct PointClick
     std::map<const std::string, int> constants, dynamic;
     Board board;
     std::vector<int> lineScore;
-    std::unique_ptr<Piece> currPiece, nextPiece;
-    InputHandler* inputPtr;
-    std::vector<Board> record;
-    std::vector<std::string> pieceSeq;
+    Piece currPiece, nextPiece;
+    InputSource* inputPtr;
+    MoveHistory record;
+    std::vector<uint8_t> pieceSeq;
     Grid displayGrid;
     PieceGenerator pieceGen;
 
@@ -42,10 +42,9 @@ struct PointClick
     void setConstants();
     void setEntryDelay();
     void resetGame();
-    void readMove(int move);
-    void truncateRecord(int moveInclusive);
+    void readMove(int node);
     std::vector<int> getGridPosition(double xpos, double ypos);
-    void assignInput(InputHandler& inputSource);
+    void assignInput(InputSource& inputSource);
 };
 
 #endif
\ No newline at end of file
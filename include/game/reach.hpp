@@ -0,0 +1,57 @@
+#ifndef REACH
+#define REACH
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+#include "game/nes.hpp"
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * The two ways that a player can shift pieces: pressing a direction once and
+ * holding it so that DAS shifts the piece, or tapping repeatedly without ever
+ * holding.
+ */
+enum class InputStyle : uint8_t
+{
+    das,
+    hypertap
+};
+
+/*
+ * The slowest tapping that the reachability search models, as frames from one
+ * press to the next. findTimedPlacements treats longer intervals as this one,
+ * which is already far slower than DAS.
+ */
+constexpr int maxTapInterval = 60;
+
+struct InputModel
+{
+    InputStyle style;
+    int tapInterval; // Fewest frames from one direction press to the next, up to maxTapInterval (hypertap only)
+};
+
+/*
+ * A TimedPlacement is a placement that can be reached in time, along with the
+ * commands of every active frame from spawn up to and including the frame on
+ * which the piece locks, packed as in replay.hpp.
+ */
+struct TimedPlacement
+{
+    Placement placement;
+    int frames;
+    int presses;
+    std::vector<uint8_t> inputs;
+};
+
+InputModel dasInput();
+InputModel hypertapInput(double tapsPerSecond);
+int findTimedPlacements(const Grid& grid, const PieceData& data, int level, int dasFrames,
+    const InputModel& input, std::vector<TimedPlacement>& placements,
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+int findTimedPlacements(const NESTetris& game, const InputModel& input, std::vector<TimedPlacement>& placements);
+
+#endif
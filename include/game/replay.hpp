@@ -0,0 +1,71 @@
+#ifndef REPLAY
+#define REPLAY
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct ReplayHeader
+{
+    uint8_t version;
+    RandomMode mode;
+    uint8_t startLevel;
+    uint32_t seed;
+    uint32_t frames;
+};
+
+uint8_t packCommands(const NESCommands& commands);
+NESCommands unpackCommands(uint8_t bits);
+
+class InputRecorder
+{
+    public:
+
+    InputRecorder(int startLevel, uint32_t seed, RandomMode mode);
+    void record(const NESCommands& commands);
+    std::vector<uint8_t> finish();
+    bool save(const std::string& filePath);
+
+    private:
+
+    ReplayHeader header;
+    std::vector<uint8_t> runs;
+    uint8_t runBits;
+    uint32_t runLength;
+
+    void endRun();
+};
+
+class InputReplayer
+{
+    public:
+
+    ReplayHeader header;
+
+    InputReplayer(std::vector<uint8_t> data);
+    bool valid() const;
+    bool finished() const;
+    bool nextFrame(NESCommands& commands);
+    uint32_t skipFrames(uint32_t frames);
+    NESTetris createGame() const;
+
+    private:
+
+    std::vector<uint8_t> data;
+    bool headerValid;
+    size_t position;
+    uint8_t runBits;
+    uint32_t runLeft;
+
+    bool readRun();
+};
+
+constexpr int replayHeaderSize = 16;
+constexpr uint8_t replayVersion = 1;
+
+std::vector<uint8_t> loadReplay(const std::string& filePath);
+
+#endif
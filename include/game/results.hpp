@@ -0,0 +1,69 @@
+#ifndef RESULTS
+#define RESULTS
+
+#include "game/nes.hpp"
+
+#include <string>
+#include <atomic>
+#include <type_traits>
+#include <cstdint>
+
+// How a game run by tetris_batch came to an end.
+enum class GameEnd : uint8_t
+{
+    topOut, // A piece spawned on top of the stack
+    frameLimit, // The game reached the frame limit of the run
+    replayEnd // The replay being played back ran out of inputs
+};
+
+/*
+ * The summary of one finished game, written to a ResultSink. Binary result
+ * files hold these records directly, after an 8-byte header.
+ */
+struct GameResult
+{
+    uint64_t gameId;
+    uint32_t seed;
+    uint32_t frames;
+    int32_t score;
+    int32_t lines;
+    int32_t lineTypeCount[4];
+    int32_t level;
+    GameEnd end;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(GameResult) == 48, "GameResult is written directly to binary result files");
+static_assert(std::is_trivially_copyable<GameResult>::value, "GameResult must be plain data");
+
+GameResult makeResult(uint64_t gameId, uint32_t seed, const NESTetris& game, uint32_t frames, GameEnd end);
+
+enum class ResultFormat : uint8_t
+{
+    csv,
+    binary
+};
+
+class ResultSink
+{
+    public:
+
+    ResultSink(const std::string& filePath, ResultFormat format);
+    ~ResultSink();
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+    bool isOpen() const;
+    bool write(const GameResult& result);
+    uint64_t size() const;
+    bool close();
+
+    private:
+
+    int fd;
+    ResultFormat format;
+    std::atomic<uint64_t> endOffset;
+    std::atomic<uint64_t> count;
+    std::atomic<bool> failed;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SCRIPTED
+#define SCRIPTED
+
+#include "game/inputsource.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+
+struct ScriptSegment
+{
+    int frames;
+    std::vector<std::string> keys;
+};
+
+class ScriptedInput : public InputSource
+{
+    public:
+
+    ScriptedInput(std::vector<ScriptSegment> script, bool loop);
+    std::map<const std::string, std::string> getStates(std::vector<std::string> keyNames) override;
+    std::vector<double> getMousePos() override;
+    std::vector<int> getWindowSize() override;
+    void nextFrame();
+    bool finished();
+    void rewind();
+
+    private:
+
+    std::vector<ScriptSegment> script;
+    bool loop;
+    int segment, segmentFrame;
+    std::vector<std::string> prevKeys;
+    std::vector<std::string> currKeys;
+};
+
+bool loadScript(const std::string& filePath, std::vector<ScriptSegment>& script);
+
+#endif
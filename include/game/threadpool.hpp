@@ -0,0 +1,45 @@
+#ifndef THREADPOOL
+#define THREADPOOL
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+class ThreadPool
+{
+    public:
+
+    ThreadPool(int numThreads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    int size() const;
+    void run(int numTasks, const std::function<void(int task, int worker)>& job);
+
+    private:
+
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const std::function<void(int, int)>* job;
+    uint64_t generation;
+    int active;
+    bool stopping;
+
+    void workerLoop(int worker);
+    bool takeTask(int worker, int& task);
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TRANSPOSITION
+#define TRANSPOSITION
+
+#include "game/grid.hpp"
+#include "game/moves.hpp"
+#include "game/evaluate.hpp"
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+uint64_t hashRows(const StackRows& rows, int height);
+uint64_t hashGrid(const Grid& grid);
+uint64_t hashPosition(uint64_t boardHash, int pieceIndex, int nextIndex, int level, int dasFrames);
+
+/*
+ * A TableResult is what a TranspositionTable remembers about a position: the
+ * score of the best placement found for it and the placement itself.
+ */
+struct TableResult
+{
+    float score;
+    Placement placement;
+};
+
+class TranspositionTable
+{
+    public:
+
+    TranspositionTable(int sizeBits);
+    bool probe(uint64_t key, TableResult& result) const;
+    void store(uint64_t key, const TableResult& result);
+    void clear();
+    int size() const;
+
+    private:
+
+    struct Slot
+    {
+        std::atomic<uint64_t> check, data;
+    };
+
+    int sizeBits;
+    std::unique_ptr<Slot[]> slots;
+};
+
+#endif
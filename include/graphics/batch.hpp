@@ -0,0 +1,54 @@
+#ifndef BATCH
+#define BATCH
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <string>
+
+struct AtlasRegion
+{
+    float u0, v0, u1, v1;
+};
+
+class TextureAtlas
+{
+    public:
+
+    TextureAtlas();
+    ~TextureAtlas();
+    int addImage(std::string filePath);
+    void build();
+    void bind();
+    AtlasRegion getRegion(int imageID);
+
+    private:
+
+    unsigned int texture;
+    int atlasWidth, atlasHeight;
+    std::vector<std::vector<unsigned char>> images;
+    std::vector<std::vector<int>> imageSizes;
+    std::vector<AtlasRegion> regions;
+};
+
+class SpriteBatch
+{
+    public:
+
+    SpriteBatch(int capacity);
+    ~SpriteBatch();
+    void addQuad(const std::vector<float>& vertices, const AtlasRegion& region, float offsetX, float offsetY);
+    void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1);
+    void flush();
+    int size();
+
+    private:
+
+    unsigned int quadArray;
+    unsigned int cornerBuffer, cornerIndexBuffer, instanceBuffer;
+    int capacity;
+    std::vector<float> instances;
+};
+
+#endif
@@ -6,20 +6,32 @@
 #include "graphics/stb_image.hpp"
 #include "graphics/shader.hpp"
 #include "graphics/text.hpp"
+#include "graphics/batch.hpp"
 
 #include <vector>
 #include <string>
 #include <memory>
 #include <map>
 
+struct BoardSources
+{
+    Grid* grid;
+    Piece* nextPiece;
+    int* lineCount;
+    int* score;
+    int* level;
+    std::vector<int>* lineTypeCount;
+};
+
 class BoardDrawer
 {
     public:
 
-    BoardDrawer(std::string location);
+    BoardDrawer(std::string location, int tileRows = 1, int tileCols = 1);
     ~BoardDrawer();
     void drawFrame();
-    void assignNextPiece(std::unique_ptr<Piece>& piecePtr);
+    void assignBoard(int tile, const BoardSources& sources);
+    void assignNextPiece(Piece& piece);
     void assignGrid(Grid& grid);
     void assignLineCount(int& lineCount);
     void assignScore(int& score);
@@ -28,32 +40,31 @@ class BoardDrawer
 
     private:
 
-    unsigned int sqrArray; 
-    unsigned int brdTexture, fontTexture;
-    unsigned int sqrBuffer, sqrIndexBuffer;
+    int brdImage, fontImage;
+    const int tileRows, tileCols;
+    const float brdWidth, brdHeight;
+    float originX, originY;
     const float gridHeight, gridWidth;
     const std::vector<float> brdVertices;
     const std::vector<float> playFieldPos, previewPos;
-    std::vector<unsigned int> blockTextures;
+    std::vector<int> blockImages;
     const std::vector<unsigned int> pieceTexMap;
     const float blockWidthSpacing, blockHeightSpacing; // Requires playFieldPos for initialization 
-    std::unique_ptr<Piece>* nextPieceSource;
-    Grid* gridSource;
-    int* lineCountSource;
-    int* scoreSource;
-    int* levelSource;
-    std::vector<int>* lineTypeCountSource;
+    std::vector<BoardSources> boards;
     Shader brdShader;
     TextDrawer textDrawer;
+    TextureAtlas atlas;
+    SpriteBatch batch;
     
     void drawBoard();
-    void drawSquare(const std::vector<float>& vertices, unsigned int texture);
-    void drawPieceBlocks();
-    void drawPreview();
-    void drawLineCount();
-    void drawLineTypeCount();
-    void drawScore();
-    void drawLevel();
+    void drawSquare(const std::vector<float>& vertices, int image);
+    void drawSquare(float left, float top, float right, float bottom, int image);
+    void drawPieceBlocks(const Grid* grid);
+    void drawPreview(const Piece* nextPiece);
+    void drawLineCount(const int* lineCount);
+    void drawLineTypeCount(const std::vector<int>* lineTypeCount);
+    void drawScore(const int* score);
+    void drawLevel(const int* level);
 };
 
 void createTexture(unsigned int& texID, std::string filePath);
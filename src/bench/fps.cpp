@@ -0,0 +1,262 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/scripted.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+
+/*
+ * Every allocation made by the program goes through these replacements of the
+ * global operator new, which count them so that the benchmark can report how
+ * many allocations each frame makes. The program runs on one thread, so the
+ * counter is a plain integer.
+ */
+namespace
+{
+long allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Frames of bot play recorded for each level, which every run plays over and over.
+constexpr long recordFrames = 20000;
+
+/*
+ * The frames played by the runs at one level: the commands that the bot chose
+ * in games at that level, recorded ahead of time so that its search is not
+ * part of the time measured, and the same frames as a script of held keys.
+ * The bot's games clear lines and top out as real games do, and when one
+ * ends the next starts with the following seed.
+ */
+struct Recording
+{
+    std::vector<NESCommands> commands;
+    std::vector<ScriptSegment> script;
+};
+
+Recording recordBot(int level)
+/*
+ * This function has the bot play recordFrames frames from seed 1 and records
+ * its commands, along with a script that holds each key down on the frames
+ * where the commands use it.
+ */
+{
+    Recording recording;
+    NESTetris game{level, 1, RandomMode::dice};
+    BotPlayer player{defaultWeights(), dasInput()};
+    uint32_t seed = 1;
+    std::vector<std::vector<std::string>> frameKeys(recordFrames);
+    for (long frame = 0; frame < recordFrames; ++frame) {
+        player.setCommands(game);
+        const NESCommands& commands = game.commands;
+        recording.commands.push_back(commands);
+        std::vector<std::string>& keys = frameKeys[frame];
+        if (commands.doCCW) keys.push_back("a");
+        if (commands.doCW) keys.push_back("s");
+        if (commands.doLeft || commands.leftDAS) keys.push_back("left");
+        if (commands.doRight || commands.rightDAS) keys.push_back("right");
+        if (commands.softDrop) keys.push_back("down");
+        game.runFrame(game.commands);
+        if (game.flags.gameOver) {
+            game.pieceGen.seed(++seed);
+            game.resetGame();
+            player.reset();
+        }
+    }
+    /*
+     * A DAS command on a frame where the key was not down on the frame before
+     * means that the bot started the piece with the key already held, so the
+     * script holds it down from the frame before as well. Otherwise the script
+     * would press the key, and setCommands would read a tap instead.
+     */
+    for (long frame = 1; frame < recordFrames; ++frame) {
+        const NESCommands& commands = recording.commands[frame];
+        std::vector<std::string>& previous = frameKeys[frame - 1];
+        if (commands.leftDAS && std::find(previous.begin(), previous.end(), "left") == previous.end()) {
+            previous.push_back("left");
+        }
+        if (commands.rightDAS && std::find(previous.begin(), previous.end(), "right") == previous.end()) {
+            previous.push_back("right");
+        }
+    }
+    for (const std::vector<std::string>& keys : frameKeys) {
+        if (!recording.script.empty() && recording.script.back().keys == keys) {
+            ++recording.script.back().frames;
+        }
+        else {
+            recording.script.push_back(ScriptSegment{1, keys});
+        }
+    }
+    return recording;
+}
+
+struct FPSResult
+{
+    int level;
+    std::string driver;
+    long frames, placements, lines, games, allocations;
+    double seconds;
+};
+
+void endGame(NESTetris& game, FPSResult& result)
+// This function adds a game that ended, or that a run stopped part way through, to the totals of the run.
+{
+    result.placements += game.dynamic.move;
+    result.lines += game.board.lineCount;
+    ++result.games;
+}
+
+FPSResult runScripted(int level, long numFrames, const Recording& recording)
+/*
+ * This function runs a game for a number of frames with its commands read
+ * from a ScriptedInput through NESTetris::setCommands, as the simulator does.
+ * The recorded games are played from the start again every recordFrames
+ * frames, with the seeds they were recorded with.
+ */
+{
+    ScriptedInput inputs{recording.script, false};
+    NESTetris game{level, 1, RandomMode::dice};
+    game.assignInput(inputs);
+    FPSResult result{level, "scripted", numFrames, 0, 0, 0, 0, 0};
+    uint32_t seed = 1;
+    long startAllocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (long frame = 0; frame < numFrames; ++frame) {
+        if (frame > 0 && frame % recordFrames == 0) {
+            endGame(game, result);
+            inputs.rewind();
+            seed = 1;
+            game.pieceGen.seed(seed);
+            game.resetGame();
+        }
+        inputs.nextFrame();
+        game.runFrame();
+        if (game.flags.gameOver) {
+            endGame(game, result);
+            game.pieceGen.seed(++seed);
+            game.resetGame();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = allocations - startAllocations;
+    endGame(game, result);
+    return result;
+}
+
+FPSResult runCommands(int level, long numFrames, const Recording& recording)
+/*
+ * This function runs the same frames as runScripted, but with the recorded
+ * commands passed straight to NESTetris::runFrame, which leaves the cost of
+ * the engine alone.
+ */
+{
+    NESTetris game{level, 1, RandomMode::dice};
+    FPSResult result{level, "commands", numFrames, 0, 0, 0, 0, 0};
+    uint32_t seed = 1;
+    long startAllocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (long frame = 0; frame < numFrames; ++frame) {
+        long recorded = frame % recordFrames;
+        if (frame > 0 && recorded == 0) {
+            endGame(game, result);
+            seed = 1;
+            game.pieceGen.seed(seed);
+            game.resetGame();
+        }
+        game.runFrame(recording.commands[recorded]);
+        if (game.flags.gameOver) {
+            endGame(game, result);
+            game.pieceGen.seed(++seed);
+            game.resetGame();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = allocations - startAllocations;
+    endGame(game, result);
+    return result;
+}
+
+std::string toJSON(const std::vector<FPSResult>& results)
+// This function writes the results as a JSON object, one entry per level and driver.
+{
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"nes_fps\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const FPSResult& result = results[i];
+        json << "    {\"level\": " << result.level
+            << ", \"driver\": \"" << result.driver << "\""
+            << ", \"frames\": " << result.frames
+            << ", \"seconds\": " << result.seconds
+            << ", \"framesPerSecond\": " << result.frames/result.seconds
+            << ", \"placements\": " << result.placements
+            << ", \"placementsPerSecond\": " << result.placements/result.seconds
+            << ", \"lines\": " << result.lines
+            << ", \"games\": " << result.games
+            << ", \"allocationsPerFrame\": " << static_cast<double>(result.allocations)/result.frames
+            << "}" << ((i + 1 < results.size()) ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+int main(int argc, char* argv[])
+{
+    /*
+     * The frame rate benchmark runs NES games without a window at levels 0,
+     * 18, 19, and 29 and reports frames per second, placements per second,
+     * lines, games, and allocations per frame as JSON, so that the numbers can
+     * be tracked from one version to the next. The frames are the bot's games,
+     * recorded before the runs, and each level is run with them read from an
+     * input script and with the commands passed directly. The first argument
+     * sets the number of frames per run (300000 by default), and if a file is
+     * passed in the second argument the JSON is written to it as well.
+     */
+    const long numFrames = (argc > 1) ? std::stol(argv[1]) : 300000;
+    const std::string outputPath = (argc > 2) ? argv[2] : std::string();
+    const std::array<int, 4> levels{0, 18, 19, 29};
+    std::vector<FPSResult> results;
+    for (int level : levels) {
+        const Recording recording = recordBot(level);
+        results.push_back(runScripted(level, numFrames, recording));
+        results.push_back(runCommands(level, numFrames, recording));
+    }
+    const std::string json = toJSON(results);
+    std::cout << json;
+    if (!outputPath.empty()) {
+        std::ofstream file(outputPath);
+        file << json;
+        if (!file) {
+            std::cout << "Error: Unable to write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <iostream>
+#include <cstdint>
+
+#include "bench/harness.hpp"
+#include "game/nes.hpp"
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/moves.hpp"
+
+/*
+ * A board as it was on an active frame of a captured game, with the piece
+ * that was falling at the time.
+ */
+struct BoardSample
+{
+    Grid grid;
+    Piece piece;
+};
+
+// A board with filled rows, as it was on the frame after a piece completed them.
+struct ClearSample
+{
+    Grid grid;
+    std::vector<int> filledRows;
+};
+
+void captureBoards(std::vector<BoardSample>& boards, std::vector<ClearSample>& clears)
+/*
+ * This function has the evaluation bot play a few games and samples their
+ * boards, so that the primitives are measured on the stacks and pieces that
+ * simulations actually see rather than on empty or random grids. The games at
+ * level 29 top out quickly and supply the tall stacks.
+ */
+{
+    const std::array<int, 2> levels{18, 29};
+    for (int level : levels) {
+        for (uint32_t seed = 1; seed <= 4; ++seed) {
+            NESTetris game{level, seed, RandomMode::dice};
+            BotPlayer player{defaultWeights(), dasInput()};
+            for (long frame = 0; frame < 6000 && !game.flags.gameOver; ++frame) {
+                player.setCommands(game);
+                if (!game.flags.frozen && game.filledRows.empty() && frame % 3 == 0) {
+                    boards.push_back(BoardSample{game.board.grid, game.currPiece});
+                }
+                if (!game.filledRows.empty() && game.dynamic.clearFrames == 0) {
+                    clears.push_back(ClearSample{game.displayGrid, game.filledRows});
+                }
+                game.runFrame(game.commands);
+            }
+        }
+    }
+}
+
+int main()
+{
+    /*
+     * The primitive benchmarks time the Grid, Piece, and PieceGenerator
+     * operations that the simulations spend their time in, and the placement
+     * search built on them. Each one cycles through the captured boards, so its
+     * time is an average over realistic inputs. Run them before and after a
+     * change to the core to judge it.
+     */
+    std::vector<BoardSample> boards;
+    std::vector<ClearSample> clears;
+    captureBoards(boards, clears);
+    long filledBlocks = 0;
+    for (const BoardSample& sample : boards) {
+        filledBlocks += sample.grid.getFilledBlocks().size();
+    }
+    std::cout << "boards " << boards.size() << " (mean " << static_cast<double>(filledBlocks)/boards.size()
+        << " blocks), line clears " << clears.size() << "\n" << std::endl;
+    const size_t numBoards = boards.size(), numClears = clears.size();
+
+    // The gravity test: each piece one row lower, which collides whenever the piece is about to lock.
+    std::vector<PieceCoords> lowered;
+    std::vector<int> bottomRows;
+    std::vector<std::array<uint16_t, 4>> rowMasks;
+    for (const BoardSample& sample : boards) {
+        Piece piece = sample.piece;
+        piece.translate(-1, 0);
+        lowered.push_back(piece.coords);
+        const BoundingBox& box = piece.data->bounds[piece.orient];
+        std::array<uint16_t, 4> masks;
+        for (int i = 0; i < 4; ++i) {
+            masks[i] = piece.data->rowMasks[piece.orient][i] << (piece.centerCol + box.minCol);
+        }
+        bottomRows.push_back(piece.centerRow + box.minRow);
+        rowMasks.push_back(masks);
+    }
+
+    runBenchmark("Grid::collisionCheck (coords)", [&](long iterations) {
+        int collisions = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            collisions += boards[k].grid.collisionCheck(lowered[k]);
+        }
+        keepValue(collisions);
+    });
+    runBenchmark("Grid::collisionCheck (row masks)", [&](long iterations) {
+        int collisions = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            collisions += boards[k].grid.collisionCheck(bottomRows[k], rowMasks[k]);
+        }
+        keepValue(collisions);
+    });
+    runBenchmark("Grid::getFilledRows (no lines)", [&](long iterations) {
+        size_t rows = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            rows += boards[k].grid.getFilledRows().size();
+        }
+        keepValue(rows);
+    });
+    runBenchmark("Grid::getFilledRows (lines)", [&](long iterations) {
+        size_t rows = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numClears)) ? 0 : k + 1) {
+            rows += clears[k].grid.getFilledRows().size();
+        }
+        keepValue(rows);
+    });
+
+    // Clearing changes the grid, so each iteration works on a copy, which is timed on its own first.
+    runBenchmark("Grid copy (baseline for clearRows)", [&](long iterations) {
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numClears)) ? 0 : k + 1) {
+            Grid grid = clears[k].grid;
+            keepValue(grid);
+        }
+    });
+    runBenchmark("Grid::clearRows (with copy)", [&](long iterations) {
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numClears)) ? 0 : k + 1) {
+            Grid grid = clears[k].grid;
+            grid.clearRows(clears[k].filledRows);
+            keepValue(grid);
+        }
+    });
+    runBenchmark("Grid::getFilledBlocks", [&](long iterations) {
+        size_t blocks = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            blocks += boards[k].grid.getFilledBlocks().size();
+        }
+        keepValue(blocks);
+    });
+
+    std::vector<Placement> placements;
+    runBenchmark("findPlacements", [&](long iterations) {
+        int found = 0;
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            found += findPlacements(boards[k].grid, *boards[k].piece.data, placements);
+        }
+        keepValue(found);
+    });
+
+    std::vector<Piece> pieces;
+    for (const BoardSample& sample : boards) {
+        pieces.push_back(sample.piece);
+    }
+    runBenchmark("Piece::rotate", [&](long iterations) {
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            pieces[k].rotate((i & 1) ? -1 : 1);
+        }
+        keepValue(pieces);
+    });
+    runBenchmark("Piece::translate", [&](long iterations) {
+        for (long i = 0, k = 0; i < iterations; ++i, k = (k + 1 == static_cast<long>(numBoards)) ? 0 : k + 1) {
+            pieces[k].translate(0, (i & 1) ? -1 : 1);
+        }
+        keepValue(pieces);
+    });
+
+    PieceGenerator generator{{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"}, 1, RandomMode::dice};
+    runBenchmark("PieceGenerator::getPiece", [&](long iterations) {
+        int rows = 0;
+        for (long i = 0; i < iterations; ++i) {
+            Piece piece = generator.getPiece(1 + i % 7);
+            rows += piece.coords[0].first;
+        }
+        keepValue(rows);
+    });
+    runBenchmark("PieceGenerator::getRandomSequence (1000)", [&](long iterations) {
+        size_t length = 0;
+        for (long i = 0; i < iterations; ++i) {
+            length += generator.getRandomSequence(1000).size();
+        }
+        keepValue(length);
+    });
+    generator.setMode(RandomMode::nesLFSR);
+    runBenchmark("PieceGenerator::getRandomSequence (1000, NES)", [&](long iterations) {
+        size_t length = 0;
+        for (long i = 0; i < iterations; ++i) {
+            length += generator.getRandomSequence(1000).size();
+        }
+        keepValue(length);
+    });
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <random>
+#include <memory>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+#include "game/environment.hpp"
+#include "game/batchnes.hpp"
+#include "game/threadpool.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+
+bool checkButtons(int level, RandomMode mode, int numGames, int numThreads, long numFrames)
+/*
+ * This function steps a batch of games and one NESEnvironment per game with
+ * the same random buttons, each held for a random number of frames, and checks
+ * that the rewards, the ends of games, the observations, and the counters of
+ * every game match on every frame. Games that top out are reset in both with
+ * the same new seed. With more than one thread, the batch is split between the
+ * threads of a pool.
+ */
+{
+    BatchNES batch{numGames, level, mode};
+    ThreadPool pool{numThreads};
+    if (numThreads > 1) {
+        batch.usePool(pool);
+    }
+    std::vector<uint8_t> expected(numGames*observationSize);
+    std::vector<std::unique_ptr<NESEnvironment>> environments;
+    for (int game = 0; game < numGames; ++game) {
+        environments.emplace_back(new NESEnvironment(level, mode, &expected[game*observationSize]));
+        environments[game]->reset(game);
+    }
+
+    std::mt19937 random(level + 1);
+    std::vector<uint8_t> buttons(numGames), dones(numGames), observations(numGames*observationSize);
+    std::vector<int> holdFrames(numGames);
+    std::vector<float> rewards(numGames);
+    for (long frame = 0; frame < numFrames; ++frame) {
+        for (int game = 0; game < numGames; ++game) {
+            if (--holdFrames[game] < 0) {
+                // Soft drops are held less often, so that the stacks have time to grow
+                buttons[game] = random() & ((random() % 3 == 0) ? 27 : 31);
+                holdFrames[game] = random() % 12;
+            }
+        }
+        batch.step(buttons.data(), rewards.data(), dones.data());
+        batch.observe(observations.data());
+        for (int game = 0; game < numGames; ++game) {
+            StepResult result = environments[game]->step(buttons[game]);
+            const NESTetris& expectedGame = environments[game]->game;
+            bool same = result.reward == rewards[game] && result.done == (dones[game] != 0) &&
+                expectedGame.dynamic.score == batch.score[game] && expectedGame.board.lineCount == batch.lineCount[game] &&
+                expectedGame.dynamic.level == batch.level[game] && expectedGame.dynamic.move == batch.move[game] &&
+                expectedGame.dynamic.totalFrames == batch.totalFrames[game] &&
+                std::memcmp(&expected[game*observationSize], &observations[game*observationSize], observationSize) == 0;
+            if (!same) {
+                std::cout << "Error: Level " << level << " game " << game << " differs from NESEnvironment on frame "
+                    << frame << std::endl;
+                return false;
+            }
+            if (result.done) {
+                uint32_t seed = random();
+                environments[game]->reset(seed);
+                batch.reset(game, seed);
+            }
+        }
+    }
+    return true;
+}
+
+// Points for each type of line clear at level 0, which scale by the level plus one.
+const std::array<int, 4> linePoints{40, 100, 300, 1200};
+
+bool checkCommands(int level, int numGames, long numFrames)
+/*
+ * This function has the bot play a game in one NESTetris per game, and passes
+ * each frame's commands to the batch through stepCommands, so that the batch is
+ * checked on long games that clear lines and change levels. The position of
+ * every piece, the DAS counter, the rewards, and the counters have to match
+ * those of the engine on every frame.
+ */
+{
+    BatchNES batch{numGames, level, RandomMode::nesLFSR};
+    std::vector<std::unique_ptr<NESTetris>> games;
+    std::vector<std::unique_ptr<BotPlayer>> players;
+    for (int game = 0; game < numGames; ++game) {
+        games.emplace_back(new NESTetris(level, game, RandomMode::nesLFSR));
+        players.emplace_back(new BotPlayer(defaultWeights(), dasInput()));
+    }
+
+    std::vector<NESCommands> commands(numGames);
+    std::vector<uint8_t> packed(numGames), dones(numGames);
+    std::vector<float> rewards(numGames);
+    for (long frame = 0; frame < numFrames; ++frame) {
+        for (int game = 0; game < numGames; ++game) {
+            players[game]->setCommands(*games[game]);
+            commands[game] = games[game]->commands;
+            packed[game] = packCommands(commands[game]);
+        }
+        batch.stepCommands(packed.data(), rewards.data(), dones.data());
+        for (int game = 0; game < numGames; ++game) {
+            NESTetris& expectedGame = *games[game];
+            if (expectedGame.flags.gameOver) {
+                continue;
+            }
+            int lines = expectedGame.board.lineCount, lineLevel = expectedGame.dynamic.level;
+            expectedGame.runFrame(commands[game]);
+            int cleared = expectedGame.board.lineCount - lines;
+            float reward = (cleared > 0) ? linePoints[cleared - 1]*(lineLevel + 1) : 0;
+            bool same = reward == rewards[game] &&
+                expectedGame.flags.gameOver == (dones[game] != 0) && expectedGame.dynamic.score == batch.score[game] &&
+                expectedGame.board.lineCount == batch.lineCount[game] && expectedGame.dynamic.level == batch.level[game] &&
+                expectedGame.dynamic.move == batch.move[game] && expectedGame.dynamic.dasFrames == batch.dasFrames[game] &&
+                expectedGame.currPiece.centerRow == batch.pieceRow[game] &&
+                expectedGame.currPiece.centerCol == batch.pieceCol[game];
+            if (!same) {
+                std::cout << "Error: Level " << level << " bot game " << game << " differs from NESTetris on frame "
+                    << frame << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    /*
+     * The batch check confirms that BatchNES plays exactly the games that
+     * NESEnvironment and NESTetris do, frame by frame, with random buttons in
+     * both random modes at levels 0, 18, 19, and 29 (once with the batch split
+     * between threads), and with the commands of the bot, whose games last long
+     * enough to clear lines and pass level thresholds.
+     */
+    const std::array<int, 4> levels{0, 18, 19, 29};
+    int failures = 0;
+    int checks = 0;
+    for (int level : levels) {
+        for (RandomMode mode : {RandomMode::dice, RandomMode::nesLFSR}) {
+            failures += !checkButtons(level, mode, 64, 1, 20000);
+            ++checks;
+        }
+    }
+    failures += !checkButtons(18, RandomMode::nesLFSR, 600, 3, 2000);
+    ++checks;
+    for (int level : {0, 18, 19}) {
+        failures += !checkCommands(level, 4, 40000);
+        ++checks;
+    }
+    std::cout << "batch checks " << checks << ", failures " << failures << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+
+bool placementBefore(const Placement& a, const Placement& b)
+// This function orders placements by orientation, then row, then column.
+{
+    return std::array<int, 3>{a.orient, a.row, a.col} < std::array<int, 3>{b.orient, b.row, b.col};
+}
+
+void searchPlacements(const Grid& grid, const PieceData& data, std::vector<Placement>& placements)
+/*
+ * This function finds the resting positions of a piece by brute force: a
+ * breadth-first search over every orientation and center reachable from the
+ * spawn position with single rotations, shifts, and drops, each tested with
+ * Grid::collisionCheck. A position is a resting position if the piece cannot
+ * drop from it. The placements are sorted so that they can be compared.
+ */
+{
+    placements.clear();
+    Piece piece{data};
+    piece.setPosition(spawnRow, spawnCol, 0);
+    if (grid.collisionCheck(piece.coords)) {
+        return;
+    }
+    std::vector<uint8_t> visited(4*Grid::maxHeight*Grid::maxWidth, 0);
+    auto index = [](const Piece& state) {
+        return (state.orient*Grid::maxHeight + state.centerRow)*Grid::maxWidth + state.centerCol;
+    };
+    std::vector<Piece> queue{piece};
+    visited[index(piece)] = 1;
+    for (size_t next = 0; next < queue.size(); ++next) {
+        const Piece state = queue[next];
+        Piece dropped = state;
+        dropped.translate(-1, 0);
+        if (grid.collisionCheck(dropped.coords)) {
+            placements.push_back(Placement{static_cast<int8_t>(state.orient), static_cast<int8_t>(state.centerCol),
+                static_cast<int8_t>(state.centerRow)});
+        }
+        std::array<Piece, 5> moves{dropped, state, state, state, state};
+        moves[1].translate(0, -1);
+        moves[2].translate(0, 1);
+        moves[3].rotate(1);
+        moves[4].rotate(-1);
+        for (const Piece& move : moves) {
+            if (!grid.collisionCheck(move.coords) && !visited[index(move)]) {
+                visited[index(move)] = 1;
+                queue.push_back(move);
+            }
+        }
+    }
+    std::sort(placements.begin(), placements.end(), placementBefore);
+}
+
+void captureGrids(std::vector<Grid>& grids)
+/*
+ * This function has the evaluation bot play games and keeps the board of
+ * every active frame on which the stack changed, so that the placements are
+ * checked on the stacks that the bot actually builds, from empty boards to
+ * the tall and ragged ones of the games at level 29 that top out.
+ */
+{
+    const std::array<int, 3> levels{18, 19, 29};
+    for (int level : levels) {
+        for (uint32_t seed = 1; seed <= 12; ++seed) {
+            NESTetris game{level, seed, RandomMode::dice};
+            BotPlayer player{defaultWeights(), dasInput()};
+            for (long frame = 0; frame < 8000 && !game.flags.gameOver; ++frame) {
+                player.setCommands(game);
+                if (!game.flags.frozen && game.filledRows.empty() &&
+                    (grids.empty() || grids.back().rows != game.board.grid.rows)) {
+                    grids.push_back(game.board.grid);
+                }
+                game.runFrame(game.commands);
+            }
+        }
+    }
+}
+
+bool checkGrid(const Grid& grid, long gridIndex)
+/*
+ * This function compares findPlacements with the brute-force search for every
+ * type of piece on one board.
+ */
+{
+    std::vector<Placement> found, expected;
+    for (size_t index = 1; index < pieceTable.size(); ++index) {
+        const PieceData& data = pieceTable[index];
+        int count = findPlacements(grid, data, found);
+        std::sort(found.begin(), found.end(), placementBefore);
+        searchPlacements(grid, data, expected);
+        bool same = count == static_cast<int>(found.size()) && found.size() == expected.size() &&
+            std::equal(found.begin(), found.end(), expected.begin(), [](const Placement& a, const Placement& b) {
+                return a.orient == b.orient && a.row == b.row && a.col == b.col;
+            });
+        if (!same) {
+            std::cout << "Error: Board " << gridIndex << " has " << expected.size() << " placements of " << data.name
+                << ", but findPlacements found " << count << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    /*
+     * The placement check confirms that findPlacements returns exactly the
+     * resting positions that a brute-force search reaches with rotations,
+     * shifts, and drops, tucks and spins included, for every piece on boards
+     * taken from the bot's games.
+     */
+    std::vector<Grid> grids;
+    captureGrids(grids);
+    int failures = 0;
+    for (size_t i = 0; i < grids.size(); ++i) {
+        failures += !checkGrid(grids[i], i);
+    }
+    std::cout << "placement checks " << grids.size() << ", failures " << failures << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <iostream>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+#include "game/reach.hpp"
+#include "game/moves.hpp"
+
+/*
+ * An input model to check, with the name it is reported under.
+ */
+struct InputCase
+{
+    std::string name;
+    InputModel input;
+};
+
+bool checkPlans(int level, const InputCase& inputCase, uint32_t seed, int numPieces)
+/*
+ * This function plays pieces by choosing one of the reachable placements that
+ * findTimedPlacements returns for each of them and passing its commands to the
+ * engine, one per frame. The engine has to lock the piece in the planned
+ * orientation and position, on the last frame of the plan and not before, and
+ * a hypertapping plan must not press a direction sooner than the tap interval
+ * allows. The placements are chosen by a simple hash of the piece count, so
+ * that the unusual placements are played as well as the likely ones, and a
+ * game that tops out is started over until enough pieces have been played.
+ */
+{
+    NESTetris game{level, seed, RandomMode::dice};
+    std::vector<TimedPlacement> placements;
+    int pieces = 0;
+    while (pieces < numPieces) {
+        if (game.flags.gameOver) {
+            game.pieceGen.seed(++seed);
+            game.resetGame();
+        }
+        if (game.flags.frozen || !game.filledRows.empty()) {
+            game.runFrame(NESCommands{});
+            continue;
+        }
+        if (findTimedPlacements(game, inputCase.input, placements) == 0) {
+            game.runFrame(NESCommands{}); // Nothing fits, so the piece is left to top out
+            continue;
+        }
+        const TimedPlacement& plan = placements[(pieces*2654435761u >> 7) % placements.size()];
+        // The search starts every piece as if the last press was long enough ago
+        int lastPress = -inputCase.input.tapInterval;
+        for (size_t step = 0; step < plan.inputs.size(); ++step) {
+            NESCommands commands = unpackCommands(plan.inputs[step]);
+            if (inputCase.input.style == InputStyle::hypertap && (commands.doLeft || commands.doRight)) {
+                if (static_cast<int>(step) - lastPress < inputCase.input.tapInterval) {
+                    std::cout << "Error: Level " << level << " " << inputCase.name << " piece " << pieces
+                        << " presses a direction " << step - lastPress << " frames after the last press" << std::endl;
+                    return false;
+                }
+                lastPress = step;
+            }
+            if (step == 0 && game.flags.dropDelay) {
+                commands.softDrop = true; // The search does not model the first piece's drop delay
+            }
+            game.runFrame(commands);
+            bool locked = game.flags.frozen || !game.filledRows.empty() || game.flags.gameOver;
+            if (locked != (step + 1 == plan.inputs.size())) {
+                std::cout << "Error: Level " << level << " " << inputCase.name << " piece " << pieces
+                    << " locked on frame " << step + 1 << " of a " << plan.inputs.size() << " frame plan" << std::endl;
+                return false;
+            }
+        }
+        const Placement& target = plan.placement;
+        if (game.currPiece.orient != target.orient || game.currPiece.centerCol != target.col ||
+            game.currPiece.centerRow != target.row) {
+            std::cout << "Error: Level " << level << " " << inputCase.name << " piece " << pieces << " locked at ("
+                << game.currPiece.orient << ", " << game.currPiece.centerRow << ", " << game.currPiece.centerCol
+                << ") instead of (" << static_cast<int>(target.orient) << ", " << static_cast<int>(target.row)
+                << ", " << static_cast<int>(target.col) << ")" << std::endl;
+            return false;
+        }
+        ++pieces;
+    }
+    return true;
+}
+
+int main()
+{
+    /*
+     * The reachability check confirms that the plans made by the reachability
+     * search are played out exactly by the engine: 1000 pieces are placed at
+     * each of levels 0, 18, 19, and 29, with DAS and with hypertapping at rates
+     * whose press intervals run from 2 to 30 frames.
+     */
+    const std::array<int, 4> levels{0, 18, 19, 29};
+    const std::vector<InputCase> inputCases{{"das", dasInput()}, {"tap30", hypertapInput(30)},
+        {"tap15", hypertapInput(15)}, {"tap4", hypertapInput(4)}, {"tap2", hypertapInput(2)}};
+    int failures = 0;
+    int checks = 0;
+    for (int level : levels) {
+        for (const InputCase& inputCase : inputCases) {
+            failures += !checkPlans(level, inputCase, level + 1, 1000);
+            ++checks;
+        }
+    }
+    std::cout << "reachability checks " << checks << ", failures " << failures << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
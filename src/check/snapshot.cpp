@@ -0,0 +1,133 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+
+bool sameGenerator(const GeneratorState& a, const GeneratorState& b)
+// This function compares two generator states field by field, since the struct has padding.
+{
+    return a.queue == b.queue && a.queueHead == b.queueHead && a.lookahead == b.lookahead &&
+        a.engine == b.engine && a.lfsr == b.lfsr && a.spawnCount == b.spawnCount &&
+        a.spawnID == b.spawnID && a.prevChoice == b.prevChoice && a.mode == b.mode;
+}
+
+bool sameState(const NESSnapshot& a, const NESSnapshot& b)
+/*
+ * This function compares two snapshots member by member. The members other
+ * than the generator state have no padding inside them, so each is compared
+ * as a block.
+ */
+{
+    return a.startLevel == b.startLevel && a.firstThreshold == b.firstThreshold &&
+        std::memcmp(&a.commands, &b.commands, sizeof(a.commands)) == 0 &&
+        std::memcmp(&a.flags, &b.flags, sizeof(a.flags)) == 0 &&
+        std::memcmp(&a.constants, &b.constants, sizeof(a.constants)) == 0 &&
+        std::memcmp(&a.dynamic, &b.dynamic, sizeof(a.dynamic)) == 0 &&
+        std::memcmp(a.lineScore, b.lineScore, sizeof(a.lineScore)) == 0 &&
+        a.lineCount == b.lineCount && std::memcmp(a.lineTypeCount, b.lineTypeCount, sizeof(a.lineTypeCount)) == 0 &&
+        a.numFilledRows == b.numFilledRows && std::memcmp(a.filledRows, b.filledRows, a.numFilledRows) == 0 &&
+        a.currIndex == b.currIndex && a.nextIndex == b.nextIndex && a.currRow == b.currRow &&
+        a.currCol == b.currCol && a.currOrient == b.currOrient && sameGenerator(a.generator, b.generator) &&
+        a.boardCells == b.boardCells && a.displayCells == b.displayCells;
+}
+
+bool checkGenerator(uint32_t seed, RandomMode mode)
+/*
+ * This function saves the state of a generator part way through a sequence,
+ * restores it into a generator with a different seed and mode, and checks that
+ * both then produce the same pieces.
+ */
+{
+    const std::vector<std::string> pieceNames{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"};
+    PieceGenerator original{pieceNames, seed, mode};
+    original.setLookahead(3);
+    original.restartStream();
+    for (int i = 0; i < 500; ++i) {
+        original.next();
+    }
+    PieceGenerator copy{pieceNames, seed + 1, (mode == RandomMode::dice) ? RandomMode::nesLFSR : RandomMode::dice};
+    copy.setState(original.getState());
+    if (!sameGenerator(original.getState(), copy.getState())) {
+        std::cout << "Error: Generator state with seed " << seed << " changed when restored" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < 5000; ++i) {
+        if (original.next() != copy.next()) {
+            std::cout << "Error: Restored generator with seed " << seed << " differs after " << i << " pieces" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkGame(int level, uint32_t seed, RandomMode mode)
+/*
+ * This function has the bot play a game, and every few hundred frames takes a
+ * snapshot of it and restores it into a second engine that was started with a
+ * different level and seed. The second engine is then given the same commands
+ * as the first, and their snapshots have to match on every frame until the
+ * next snapshot is taken or the game ends.
+ */
+{
+    NESTetris game{level, seed, mode};
+    NESTetris copy{(level == 0) ? 19 : 0, seed + 1, RandomMode::dice};
+    BotPlayer player{defaultWeights(), dasInput()};
+    for (long frame = 0; frame < 30000 && !game.flags.gameOver; ++frame) {
+        player.setCommands(game);
+        if (frame % 331 == 0) {
+            NESSnapshot state = game.snapshot();
+            copy.restore(state);
+            if (!sameState(state, copy.snapshot())) {
+                std::cout << "Error: Level " << level << " seed " << seed << " snapshot changed when restored on frame "
+                    << frame << std::endl;
+                return false;
+            }
+        }
+        const NESCommands commands = game.commands;
+        game.runFrame(commands);
+        copy.runFrame(commands);
+        if (!sameState(game.snapshot(), copy.snapshot())) {
+            std::cout << "Error: Level " << level << " seed " << seed << " restored game differs on frame "
+                << frame << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    /*
+     * The snapshot check confirms that NESTetris::snapshot and restore, and the
+     * PieceGenerator state beneath them, capture everything a game depends on:
+     * a restored game has to continue exactly as the original does. Games are
+     * played by the bot at several levels with both random modes.
+     */
+    int failures = 0;
+    int checks = 0;
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        for (RandomMode mode : {RandomMode::dice, RandomMode::nesLFSR}) {
+            failures += !checkGenerator(seed*7919, mode);
+            ++checks;
+        }
+    }
+    const std::array<int, 4> levels{0, 18, 19, 29};
+    for (int level : levels) {
+        for (uint32_t seed = 1; seed <= 3; ++seed) {
+            for (RandomMode mode : {RandomMode::dice, RandomMode::nesLFSR}) {
+                failures += !checkGame(level, seed, mode);
+                ++checks;
+            }
+        }
+    }
+    std::cout << "snapshot checks " << checks << ", failures " << failures << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
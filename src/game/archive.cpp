@@ -0,0 +1,366 @@
+#include "game/archive.hpp"
+
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * An archive holds many recorded NES games in one file that is only ever
+ * appended to. The file is laid out as:
+ *      an 8-byte header, "NESARCH1"
+ *      one record per game
+ *      the index, one ArchiveEntry per game sorted by game id
+ *      an ArchiveTrailer giving the position and size of the index
+ * Each record holds the game's replay (see replay.cpp) followed by a table
+ * of CheckpointEntry structs and the checkpoint data they point to. The
+ * checkpoints are blobs holding the state of the game after a given frame
+ * (an NESSnapshot), so that a reader can start from the nearest one instead 
+ * of frame 0.
+ * Everything is aligned to 8 bytes and the index structs are stored exactly
+ * as they are in memory (little-endian), so a reader can map the file and use
+ * the index in place without parsing it. Appending to an archive never
+ * changes what is already in the file: the new records are written after the
+ * old trailer, and closing the writer writes an index of every game and a new
+ * trailer after them. Readers use the last complete trailer in the file, so
+ * an archive that is being appended to, or whose writer was interrupted,
+ * still reads as it was before the append.
+ */
+
+const char archiveMagic[8] = {'N', 'E', 'S', 'A', 'R', 'C', 'H', '1'};
+const char indexMagic[8] = {'N', 'E', 'S', 'A', 'I', 'D', 'X', '1'};
+
+uint64_t padTo8(uint64_t size)
+// This function rounds a size up to the next multiple of 8.
+{
+    return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+uint64_t findTrailer(const uint8_t* base, uint64_t length, ArchiveTrailer& trailer)
+/*
+ * This function finds the last complete trailer of a mapped archive, returning
+ * the position just past it, or 0 if the file is not an archive. A trailer is
+ * only accepted if the index it describes ends right where it begins. The
+ * trailer is normally at the very end of the file, and the earlier positions
+ * are only searched when an append was interrupted before its trailer was
+ * written.
+ */
+{
+    if (length < sizeof(archiveMagic) + sizeof(ArchiveTrailer) || !std::equal(base, base + 8, archiveMagic)) {
+        return 0;
+    }
+    uint64_t end = length & ~static_cast<uint64_t>(7);
+    for (; end >= sizeof(archiveMagic) + sizeof(ArchiveTrailer); end -= 8) {
+        std::memcpy(&trailer, base + end - sizeof(ArchiveTrailer), sizeof(trailer));
+        if (std::equal(trailer.magic, trailer.magic + 8, indexMagic) && trailer.indexOffset >= sizeof(archiveMagic) &&
+            trailer.count <= (end - sizeof(ArchiveTrailer))/sizeof(ArchiveEntry) &&
+            trailer.indexOffset + trailer.count*sizeof(ArchiveEntry) + sizeof(ArchiveTrailer) == end) {
+            return end;
+        }
+    }
+    return 0;
+}
+
+ArchiveCheckpoint makeCheckpoint(uint32_t frame, const NESTetris& game)
+// This function creates a checkpoint holding a snapshot of the game after the passed number of frames.
+{
+    NESSnapshot state = game.snapshot();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+    return ArchiveCheckpoint{frame, std::vector<uint8_t>(bytes, bytes + sizeof(state))};
+}
+
+ArchiveWriter::ArchiveWriter(const std::string& filePath) :
+/*
+ * The ArchiveWriter class adds games to an archive, creating it if it does not
+ * exist. If the file exists but is not an archive it is left untouched and the
+ * writer is not opened. The games already in the archive are read from its
+ * last index, and nothing before the end of the file is ever overwritten.
+ */
+filePath{filePath}, // Location of the archive
+file{}, // Output stream, appending to the end of the file
+endOffset{0}, // Position of the end of the file, where the next record starts
+index{}, // Index entries of every game in the archive
+gameIds{} // Ids of every game in the archive, used to reject duplicates
+{
+    struct stat status;
+    if (stat(filePath.c_str(), &status) == 0 && status.st_size > 0) {
+        uint64_t fileSize = status.st_size;
+        int fd = open(filePath.c_str(), O_RDONLY);
+        void* mapping = (fd >= 0) ? mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        const uint8_t* base = (mapping != MAP_FAILED) ? static_cast<const uint8_t*>(mapping) : nullptr;
+        ArchiveTrailer trailer;
+        if (!base || findTrailer(base, fileSize, trailer) == 0) {
+            std::cout << "Error: " << filePath << " is not a valid archive" << std::endl;
+            if (base) {
+                munmap(mapping, fileSize);
+            }
+            return;
+        }
+        const ArchiveEntry* entries = reinterpret_cast<const ArchiveEntry*>(base + trailer.indexOffset);
+        index.assign(entries, entries + trailer.count);
+        for (const auto& entry : index) {
+            gameIds.insert(entry.gameId);
+        }
+        munmap(mapping, fileSize);
+
+        // The old index and trailer are kept, and anything left by an interrupted append is padded over
+        file.open(filePath, std::ios::binary | std::ios::app);
+        const char zeros[8] = {};
+        file.write(zeros, padTo8(fileSize) - fileSize);
+        endOffset = padTo8(fileSize);
+    }
+    else {
+        file.open(filePath, std::ios::binary | std::ios::trunc);
+        file.write(archiveMagic, sizeof(archiveMagic));
+        endOffset = sizeof(archiveMagic);
+    }
+    if (!file) {
+        std::cout << "Error: Unable to write archive " << filePath << std::endl;
+        file.close();
+    }
+}
+
+ArchiveWriter::~ArchiveWriter()
+// The index is written when the writer is destroyed if close was not called.
+{
+    close();
+}
+
+bool ArchiveWriter::isOpen() const
+// This function reports whether games can be added to the archive.
+{
+    return file.is_open();
+}
+
+size_t ArchiveWriter::size() const
+// This function returns the number of games in the archive, including those already in the file.
+{
+    return index.size();
+}
+
+void ArchiveWriter::writePadded(const void* data, size_t size)
+// This function writes a block of data followed by zeros up to the next multiple of 8 bytes.
+{
+    const char zeros[8] = {};
+    file.write(static_cast<const char*>(data), size);
+    file.write(zeros, padTo8(size) - size);
+    endOffset += padTo8(size);
+}
+
+bool ArchiveWriter::addGame(uint64_t gameId, const std::vector<uint8_t>& replay, const NESTetris& game,
+    const std::vector<ArchiveCheckpoint>& checkpoints)
+/*
+ * This function appends a game to the archive, given its replay, the game as
+ * it was at the end of the replay (for the summary stored in the index), and
+ * any checkpoints, which must be in order of increasing frame. Games are
+ * identified by id, and adding an id that is already in the archive fails.
+ */
+{
+    if (!isOpen() || gameIds.count(gameId)) {
+        std::cout << "Error: Unable to add game " << gameId << " to archive" << std::endl;
+        return false;
+    }
+    InputReplayer replayer{replay};
+    ArchiveEntry entry{};
+    entry.gameId = gameId;
+    entry.offset = endOffset;
+    entry.replayLength = replay.size();
+    entry.checkpointCount = checkpoints.size();
+    entry.frames = replayer.header.frames;
+    entry.score = game.dynamic.score;
+    entry.lines = game.board.lineCount;
+    for (int i = 0; i < 4; ++i) {
+        entry.lineTypeCount[i] = game.board.lineTypeCount[i];
+    }
+    writePadded(replay.data(), replay.size());
+
+    // The checkpoint data follows the table, with each block starting on a multiple of 8
+    std::vector<CheckpointEntry> table;
+    uint64_t dataOffset = endOffset + checkpoints.size()*sizeof(CheckpointEntry);
+    for (const auto& checkpoint : checkpoints) {
+        table.push_back(CheckpointEntry{checkpoint.frame, static_cast<uint32_t>(checkpoint.data.size()), dataOffset});
+        dataOffset += padTo8(checkpoint.data.size());
+    }
+    writePadded(table.data(), table.size()*sizeof(CheckpointEntry));
+    for (const auto& checkpoint : checkpoints) {
+        writePadded(checkpoint.data.data(), checkpoint.data.size());
+    }
+
+    index.push_back(entry);
+    gameIds.insert(gameId);
+    return static_cast<bool>(file);
+}
+
+bool ArchiveWriter::close()
+/*
+ * This function writes the index of every game in the archive, sorted by game
+ * id so that readers can search it in place, followed by the trailer, and
+ * closes the file. Until the trailer is written readers keep using the
+ * previous one.
+ */
+{
+    if (!isOpen()) {
+        return false;
+    }
+    std::sort(index.begin(), index.end(),
+        [](const ArchiveEntry& a, const ArchiveEntry& b) {return a.gameId < b.gameId;});
+    ArchiveTrailer trailer{endOffset, index.size(), {}};
+    std::memcpy(trailer.magic, indexMagic, sizeof(indexMagic));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size()*sizeof(ArchiveEntry));
+    file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    bool success = static_cast<bool>(file);
+    file.close();
+    return success;
+}
+
+ArchiveReader::ArchiveReader(const std::string& filePath) :
+/*
+ * The ArchiveReader class maps an archive into memory and reads games from it
+ * directly, so opening an archive of any size only requires checking the
+ * trailer. If the file cannot be mapped or is not an archive, the reader
+ * is left empty.
+ */
+base{nullptr}, // Start of the mapped file
+length{0}, // Size of the mapped file
+index{nullptr}, // Start of the index within the mapped file
+count{0} // Number of games in the index
+{
+    int fd = open(filePath.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(archiveMagic) + sizeof(ArchiveTrailer))) {
+        std::cout << "Error: Unable to open archive " << filePath << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping stays valid after the file is closed
+    if (mapping == MAP_FAILED) {
+        std::cout << "Error: Unable to map archive " << filePath << std::endl;
+        return;
+    }
+    base = static_cast<const uint8_t*>(mapping);
+    length = status.st_size;
+
+    ArchiveTrailer trailer;
+    if (findTrailer(base, length, trailer) == 0) {
+        std::cout << "Error: " << filePath << " is not a valid archive" << std::endl;
+        munmap(const_cast<uint8_t*>(base), length);
+        base = nullptr;
+        length = 0;
+        return;
+    }
+    index = reinterpret_cast<const ArchiveEntry*>(base + trailer.indexOffset);
+    count = trailer.count;
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    if (base) {
+        munmap(const_cast<uint8_t*>(base), length);
+    }
+}
+
+bool ArchiveReader::isOpen() const
+// This function reports whether an archive was successfully mapped.
+{
+    return base != nullptr;
+}
+
+size_t ArchiveReader::size() const
+// This function returns the number of games in the archive.
+{
+    return count;
+}
+
+const ArchiveEntry* ArchiveReader::getEntry(size_t position) const
+// This function returns the index entry at the given position (in order of game id).
+{
+    return (position < count) ? &index[position] : nullptr;
+}
+
+const ArchiveEntry* ArchiveReader::findGame(uint64_t gameId) const
+// This function finds the index entry of a game with a binary search, returning nullptr if there is none.
+{
+    const ArchiveEntry* entry = std::lower_bound(index, index + count, gameId,
+        [](const ArchiveEntry& a, uint64_t id) {return a.gameId < id;});
+    return (entry != index + count && entry->gameId == gameId) ? entry : nullptr;
+}
+
+InputReplayer ArchiveReader::getReplay(const ArchiveEntry& entry) const
+// This function returns a replayer for a game, which is invalid if the record is damaged.
+{
+    if (entry.offset + entry.replayLength > length) {
+        return InputReplayer{{}};
+    }
+    return InputReplayer{std::vector<uint8_t>(base + entry.offset, base + entry.offset + entry.replayLength)};
+}
+
+const CheckpointEntry* ArchiveReader::findCheckpoint(const ArchiveEntry& entry, uint32_t frame) const
+/*
+ * This function returns the last checkpoint of a game at or before the passed
+ * frame, or nullptr if there is none (in which case the game has to be
+ * replayed from the start).
+ */
+{
+    uint64_t tableOffset = entry.offset + padTo8(entry.replayLength);
+    if (tableOffset + entry.checkpointCount*sizeof(CheckpointEntry) > length) {
+        return nullptr;
+    }
+    const CheckpointEntry* table = reinterpret_cast<const CheckpointEntry*>(base + tableOffset);
+    const CheckpointEntry* after = std::upper_bound(table, table + entry.checkpointCount, frame,
+        [](uint32_t target, const CheckpointEntry& checkpoint) {return target < checkpoint.frame;});
+    return (after != table) ? after - 1 : nullptr;
+}
+
+const uint8_t* ArchiveReader::getCheckpointData(const CheckpointEntry& checkpoint) const
+// This function returns the data of a checkpoint, or nullptr if the record is damaged.
+{
+    return (checkpoint.offset + checkpoint.size <= length) ? base + checkpoint.offset : nullptr;
+}
+
+uint32_t ArchiveReader::seekGame(const ArchiveEntry& entry, uint32_t frame, NESTetris& game) const
+/*
+ * This function sets the passed game to the state of an archived game after
+ * the passed number of frames. The game is restored from the last checkpoint
+ * before that frame and the replay is run forward from there, or from the
+ * start if there is no usable checkpoint. The number of frames reached is 
+ * returned, which is less than requested if the game is shorter.
+ */
+{
+    InputReplayer replayer = getReplay(entry);
+    if (!replayer.valid()) {
+        return 0;
+    }
+    game = replayer.createGame();
+    uint32_t current = 0;
+    const CheckpointEntry* checkpoint = findCheckpoint(entry, frame);
+    const uint8_t* data = checkpoint ? getCheckpointData(*checkpoint) : nullptr;
+    if (data && checkpoint->size == sizeof(NESSnapshot)) {
+        NESSnapshot state;
+        std::memcpy(&state, data, sizeof(state));
+        game.restore(state);
+        current = replayer.skipFrames(checkpoint->frame);
+    }
+    NESCommands commands{};
+    while (current < frame && replayer.nextFrame(commands)) {
+        game.runFrame(commands);
+        ++current;
+    }
+    return current;
+}
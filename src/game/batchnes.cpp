@@ -0,0 +1,485 @@
+#include "game/batchnes.hpp"
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+#include "game/environment.hpp"
+#include "game/threadpool.hpp"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+// Bits of the packed commands, laid out as in packCommands.
+constexpr uint8_t commandCCW = 1 << 0, commandCW = 1 << 1, commandLeft = 1 << 2, commandRight = 1 << 3,
+    commandDrop = 1 << 4, commandLeftDAS = 1 << 5, commandRightDAS = 1 << 6;
+constexpr uint8_t moveCommands = commandCCW | commandCW | commandLeft | commandRight | commandLeftDAS | commandRightDAS;
+
+// Points for each type of line clear at level 0, which scale by the level plus one.
+constexpr std::array<int32_t, 4> linePoints{40, 100, 300, 1200};
+
+// Games stepped by one task of the thread pool.
+constexpr int chunkSize = 256;
+
+// The row masks of one orientation of a piece packed into a word, 16 bits per row, with the corner of its bounding box.
+struct PackedMasks
+{
+    uint64_t masks;
+    int8_t minRow, minCol;
+};
+
+constexpr std::array<PackedMasks, 4*pieceTable.size()> packMasks()
+// This function packs the row masks of every orientation of every piece, indexed by 4*index + orientation.
+{
+    std::array<PackedMasks, 4*pieceTable.size()> packed{};
+    for (size_t index = 0; index < pieceTable.size(); ++index) {
+        for (int turns = 0; turns < 4; ++turns) {
+            const std::array<uint16_t, 4>& masks = pieceTable[index].rowMasks[turns];
+            PackedMasks& entry = packed[4*index + turns];
+            entry.masks = masks[0] | (uint64_t{masks[1]} << 16) | (uint64_t{masks[2]} << 32) | (uint64_t{masks[3]} << 48);
+            entry.minRow = pieceTable[index].bounds[turns].minRow;
+            entry.minCol = pieceTable[index].bounds[turns].minCol;
+        }
+    }
+    return packed;
+}
+
+constexpr std::array<PackedMasks, 4*pieceTable.size()> packedMasks = packMasks();
+
+inline uint64_t stackOverlap(const uint16_t* board, int index, int turns, int row, int col)
+/*
+ * This function returns the blocks of a piece with the passed orientation and
+ * center that overlap the stack, the walls, or the floor of a board, as four
+ * rows of 16 bits from the bottom of its bounding box. The four board rows are
+ * read as one word, so that the test is the same few instructions for every
+ * piece, and a piece's rows never spill into one another when it is shifted.
+ */
+{
+    const PackedMasks& packed = packedMasks[4*index + turns];
+    const uint16_t* rows = board + batchFloorRows + row + packed.minRow;
+    uint64_t stack = rows[0] | (uint64_t{rows[1]} << 16) | (uint64_t{rows[2]} << 32) | (uint64_t{rows[3]} << 48);
+    return stack & (packed.masks << (col + packed.minCol + batchWallBits));
+}
+
+/*
+ * The passes of BatchNES::stepRange that every game goes through take the
+ * arrays they use as __restrict parameters, which tell the compiler that the
+ * arrays do not alias one another. Without them any store could change any of
+ * the other arrays, and none of the passes vectorize. Each choice between two
+ * values is made with a mask of all ones or all zeros rather than a branch.
+ */
+
+void gravityPass(int begin, int end, int32_t firstDelay, const uint8_t* __restrict phase,
+    const uint8_t* __restrict commands, const uint8_t* __restrict setGravity, const int32_t* __restrict totalFrames,
+    uint8_t* __restrict dropDelay, uint8_t* __restrict dropFrames, uint8_t* __restrict wasActive,
+    uint8_t* __restrict drops)
+// This function decides whether each falling piece tries to drop this frame, which shifts and rotations do not affect.
+{
+    for (int game = begin; game < end; ++game) {
+        uint8_t active = phase[game] == phaseActive;
+        uint8_t soft = (commands[game] & commandDrop) != 0;
+        uint8_t delay = dropDelay[game] & (totalFrames[game] < firstDelay) & (soft ^ 1);
+        uint8_t activeMask = -active, softMask = -soft;
+        uint8_t gravity = (((setGravity[game] + 1) >> 1) & softMask) | (setGravity[game] & ~softMask);
+        uint8_t drop = active & (delay ^ 1) & (dropFrames[game] >= gravity);
+        uint8_t dropMask = -drop;
+        wasActive[game] = active;
+        drops[game] = drop;
+        dropDelay[game] = (delay & activeMask) | (dropDelay[game] & ~activeMask);
+        dropFrames[game] = ((dropFrames[game] + 1) & activeMask & ~dropMask) | (dropFrames[game] & ~activeMask);
+    }
+}
+
+void collisionPass(int begin, int end, const uint16_t* __restrict boards, const uint8_t* __restrict piece,
+    const uint8_t* __restrict orient, const int8_t* __restrict pieceCol, int8_t* __restrict pieceRow,
+    uint8_t* __restrict drops)
+/*
+ * This function tests the row below every piece, dropping the pieces that fit
+ * and marking the others to lock. Reading each board's rows is a gather, which
+ * GCC does not vectorize on x86-64, so this pass runs one game at a time, but
+ * without a call or a branch per game.
+ */
+{
+    for (int game = begin; game < end; ++game) {
+        uint8_t collision = stackOverlap(boards + game*batchRows, piece[game], orient[game],
+            pieceRow[game] - 1, pieceCol[game]) != 0;
+        uint8_t drop = drops[game] + (drops[game] & collision);
+        drops[game] = drop;
+        pieceRow[game] -= drop == 1;
+    }
+}
+
+void timerPass(int begin, int end, const uint8_t* __restrict phase, const uint8_t* __restrict wasActive,
+    const uint8_t* __restrict entryDelay, uint8_t* __restrict frozenFrames, uint8_t* __restrict clearFrames,
+    uint8_t* __restrict drops)
+// This function advances the entry delay and line clear timers, marking the games whose next piece spawns.
+{
+    for (int game = begin; game < end; ++game) {
+        uint8_t waiting = wasActive[game] ^ 1;
+        uint8_t frozen = waiting & (phase[game] == phaseEntryDelay);
+        uint8_t clearing = waiting & (phase[game] == phaseLineClear);
+        uint8_t frozenCount = frozenFrames[game] + frozen, clearCount = clearFrames[game] + clearing;
+        frozenFrames[game] = frozenCount;
+        clearFrames[game] = clearCount;
+        drops[game] = (frozen & (frozenCount >= entryDelay[game])) | (clearing & (clearCount >= 17 + entryDelay[game]));
+    }
+}
+}
+
+BatchNES::BatchNES(int numGames, int startLevel, RandomMode mode) :
+/*
+ * The BatchNES class runs many NES mode games side by side with the same
+ * rules, timing, and piece sequences as NESTetris, for collecting data where
+ * the cost of each game matters more than its features. Instead of one object
+ * per game, each variable of the game is an array with one element per game,
+ * and a step advances every game by one frame. The step works through the
+ * games in passes, one per part of the frame: reading the controller, gravity
+ * and the drop timers, shifts and rotations, the downward collision test, and
+ * the entry delay and line clear timers. The passes that every game goes
+ * through are written without branches over contiguous arrays, so that the
+ * compiler can vectorize them across games, and the work that only some games
+ * need on a given frame (shifting, locking, spawning) is done for those games
+ * alone.
+ *
+ * Boards hold only occupancy, and there is no display grid or line clear
+ * animation, only its timing. Each game starts from the seed equal to its
+ * index until it is reset, and a game that tops out stays over until it is
+ * reset.
+ */
+numGames{numGames}, // Number of games in the batch
+startLevel{startLevel}, // Level that every game starts at
+firstThreshold{0}, // Lines needed to advance from the first level, as in NESTetris
+mode{mode}, // How the games choose their pieces
+constants{getLevelConstants(startLevel)}, // Timing constants that are the same at every level
+pool{nullptr}, // Threads to split the games between, or nullptr to step them all on the calling thread
+boards(numGames*batchRows), // Occupancy masks of every board
+phase(numGames), // What each game is doing this frame (one of the EnvironmentPhase values)
+piece(numGames), // Index of the current piece
+nextPiece(numGames), // Index of the next piece
+orient(numGames), // Orientation of the current piece
+pieceRow(numGames), // Row of the center of the current piece
+pieceCol(numGames), // Column of the center of the current piece
+dropDelay(numGames), // Whether the first piece's drop delay is still in effect
+dropFrames(numGames), // Frames since the piece last dropped
+dasFrames(numGames), // DAS counter
+frozenFrames(numGames), // Frames of the current entry delay so far
+clearFrames(numGames), // Frames of the current line clear so far
+entryDelay(numGames), // Length of the current entry delay
+setGravity(numGames), // Frames between drops at the current level, less one
+prevButtons(numGames), // Buttons held on the previous frame
+commands(numGames), // Commands of the current frame, packed as in packCommands
+level(numGames), // Current level
+lineCount(numGames), // Lines cleared
+score(numGames), // Score, computed as NESTetris::updateScore does
+move(numGames), // Pieces locked
+totalFrames(numGames), // Frames since the game started
+lineTypeCount(4*numGames), // Singles, doubles, triples, and tetrises
+generators{}, // Piece generator of each game
+wasActive(numGames), // Whether each game had a falling piece at the start of the frame
+drops(numGames) // Scratch flags for the pass being run
+{
+    if (startLevel <= 9) firstThreshold = 10*(startLevel + 1);
+    else if (startLevel > 9 && startLevel <= 15) firstThreshold = 100;
+    else firstThreshold = 10*(startLevel - 5);
+
+    std::vector<std::string> pieceList{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"};
+    generators.reserve(numGames);
+    for (int game = 0; game < numGames; ++game) {
+        generators.emplace_back(pieceList, game, mode);
+        reset(game, game);
+    }
+}
+
+void BatchNES::usePool(ThreadPool& pool)
+// This function makes steps split the games between the threads of a pool.
+{
+    this->pool = &pool;
+}
+
+void BatchNES::reset(int game, uint32_t seed)
+// This function starts a game over, with its pieces fixed by the seed as in an NESTetris game with that seed.
+{
+    generators[game].seed(seed);
+    generators[game].restartStream();
+
+    uint16_t* board = &boards[game*batchRows];
+    std::fill_n(board, batchFloorRows, batchFullRow);
+    std::fill(board + batchFloorRows, board + batchRows, batchEmptyRow);
+
+    dropDelay[game] = true;
+    dropFrames[game] = 0;
+    dasFrames[game] = 0;
+    frozenFrames[game] = 0;
+    clearFrames[game] = 0;
+    entryDelay[game] = 0;
+    setGravity[game] = constants.setGravity;
+    prevButtons[game] = 0;
+    commands[game] = 0;
+    level[game] = startLevel;
+    lineCount[game] = 0;
+    score[game] = 0;
+    move[game] = 0;
+    totalFrames[game] = 0;
+    for (int type = 0; type < 4; ++type) {
+        lineTypeCount[type*numGames + game] = 0;
+    }
+    spawnPiece(game);
+}
+
+void BatchNES::resetAll(const uint32_t* seeds)
+// This function starts every game over, each with its own seed.
+{
+    for (int game = 0; game < numGames; ++game) {
+        reset(game, seeds[game]);
+    }
+}
+
+void BatchNES::step(const uint8_t* buttons, float* rewards, uint8_t* dones)
+/*
+ * This function advances every game by one frame, with the controller buttons
+ * held in each game (ControllerButton values, read as NESEnvironment::step
+ * reads them) taken from buttons. The points earned by each game's line clears
+ * on this frame are written to rewards, and whether each game is over to dones.
+ */
+{
+    runStep(buttons, true, rewards, dones);
+}
+
+void BatchNES::stepCommands(const uint8_t* packedCommands, float* rewards, uint8_t* dones)
+/*
+ * This function is the same as step, except that the commands of each game
+ * are given directly, packed as in packCommands (with the reset bit ignored),
+ * so that recorded games or bot plans can be played back.
+ */
+{
+    runStep(packedCommands, false, rewards, dones);
+}
+
+void BatchNES::runStep(const uint8_t* inputs, bool buttons, float* rewards, uint8_t* dones)
+// This function advances every game by one frame, splitting the games between the threads of the pool if there is one.
+{
+    if (pool) {
+        int numTasks = (numGames + chunkSize - 1) / chunkSize;
+        pool->run(numTasks, [&](int task, int) {
+            stepRange(task*chunkSize, std::min(numGames, (task + 1)*chunkSize), inputs, buttons, rewards, dones);
+        });
+    }
+    else {
+        stepRange(0, numGames, inputs, buttons, rewards, dones);
+    }
+}
+
+void BatchNES::stepRange(int begin, int end, const uint8_t* inputs, bool buttons, float* rewards, uint8_t* dones)
+/*
+ * This function advances the games from begin up to end by one frame,
+ * following NESTetris::runFrame, with inputs holding either the buttons or the
+ * packed commands of each game.
+ */
+{
+    // Controller: a button held now but not on the last frame is a press, and one held on both is a hold.
+    if (buttons) {
+        for (int game = begin; game < end; ++game) {
+            uint8_t now = inputs[game], pressed = now & ~prevButtons[game], held = now & prevButtons[game];
+            uint8_t left = now & 1, right = (now >> 1) & 1, down = (now >> 2) & 1, a = (now >> 3) & 1, b = (now >> 4) & 1;
+            commands[game] = (((pressed >> 3) & 1 & ~b) << 0) | (((pressed >> 4) & 1 & ~a) << 1) |
+                ((pressed & 1 & ~right) << 2) | (((pressed >> 1) & 1 & ~left) << 3) | (down << 4) |
+                ((held & 1) << 5) | (((held >> 1) & 1) << 6);
+            prevButtons[game] = now;
+        }
+    }
+    else {
+        for (int game = begin; game < end; ++game) {
+            commands[game] = inputs[game] & (moveCommands | commandDrop);
+        }
+    }
+    std::fill(rewards + begin, rewards + end, 0.0f);
+
+    if (mode == RandomMode::nesLFSR) {
+        for (int game = begin; game < end; ++game) {
+            generators[game].advanceFrame();
+        }
+    }
+
+    gravityPass(begin, end, constants.firstDelay, phase.data(), commands.data(), setGravity.data(), totalFrames.data(),
+        dropDelay.data(), dropFrames.data(), wasActive.data(), drops.data());
+
+    for (int game = begin; game < end; ++game) {
+        if (wasActive[game] && (commands[game] & moveCommands)) {
+            movePiece(game);
+        }
+    }
+
+    /*
+     * The collision test below each piece is made for every game, and only used
+     * by those that drop, leaving drops at 1 for a piece that falls a row and 2
+     * for one that locks.
+     */
+    collisionPass(begin, end, boards.data(), piece.data(), orient.data(), pieceCol.data(), pieceRow.data(), drops.data());
+    for (int game = begin; game < end; ++game) {
+        if (drops[game] == 2) {
+            lockPiece(game, rewards[game]);
+        }
+    }
+
+    // Entry delays and line clears, for the games that were already in one when the frame began.
+    timerPass(begin, end, phase.data(), wasActive.data(), entryDelay.data(), frozenFrames.data(), clearFrames.data(),
+        drops.data());
+    for (int game = begin; game < end; ++game) {
+        if (drops[game]) {
+            frozenFrames[game] = 0;
+            clearFrames[game] = 0;
+            spawnPiece(game);
+        }
+    }
+
+    for (int game = begin; game < end; ++game) {
+        ++totalFrames[game];
+        dones[game] = phase[game] == phaseGameOver;
+    }
+}
+
+bool BatchNES::collides(int game, int newOrient, int row, int col) const
+/*
+ * This function checks whether the current piece of a game would overlap the
+ * stack, the walls, or the floor with the passed orientation and center. The
+ * piece's row masks are lined up with the board rows from the bottom of its
+ * bounding box, and all four are tested whether or not they are used.
+ */
+{
+    return stackOverlap(&boards[game*batchRows], piece[game], newOrient, row, col) != 0;
+}
+
+void BatchNES::movePiece(int game)
+// This function applies the rotation and shift commands of a game, in the order of NESTetris::runActiveFrame.
+{
+    const PieceData& data = pieceTable[piece[game]];
+    uint8_t frameCommands = commands[game];
+    int turns = orient[game], row = pieceRow[game], col = pieceCol[game], das = dasFrames[game];
+    if (frameCommands & commandCCW) {
+        int turned = (turns + data.numOrients - 1) % data.numOrients;
+        if (!collides(game, turned, row, col)) turns = turned;
+    }
+    if (frameCommands & commandCW) {
+        int turned = (turns + 1) % data.numOrients;
+        if (!collides(game, turned, row, col)) turns = turned;
+    }
+    for (int side = 0; side < 2; ++side) {
+        int shift = (side == 0) ? -1 : 1;
+        uint8_t tap = (side == 0) ? commandLeft : commandRight;
+        uint8_t hold = (side == 0) ? commandLeftDAS : commandRightDAS;
+        if (frameCommands & tap) {
+            das = 0;
+            if (collides(game, turns, row, col + shift)) das = constants.dasLimit;
+            else col += shift;
+        }
+        if (frameCommands & hold) {
+            if (das >= constants.dasLimit) {
+                das = constants.dasFloor;
+                if (collides(game, turns, row, col + shift)) das = constants.dasLimit;
+                else col += shift;
+            }
+            else {
+                ++das;
+            }
+        }
+    }
+    orient[game] = turns;
+    pieceCol[game] = col;
+    dasFrames[game] = das;
+}
+
+void BatchNES::lockPiece(int game, float& reward)
+/*
+ * This function locks the current piece of a game into its board, clears any
+ * rows it filled, and updates the line counts, score, and level as NESTetris
+ * does, adding the points of the clear at the level it was made on to reward.
+ * Blocks above the playfield are lost, as they are on a Grid.
+ */
+{
+    ++move[game];
+    entryDelay[game] = getEntryDelay(pieceRow[game]);
+    const PieceData& data = pieceTable[piece[game]];
+    const BoundingBox& box = data.bounds[orient[game]];
+    uint16_t* rows = &boards[game*batchRows + batchFloorRows];
+    int bottom = pieceRow[game] + box.minRow, shift = pieceCol[game] + box.minCol + batchWallBits;
+    for (int i = 0; i < 4 && bottom + i < 20; ++i) {
+        rows[bottom + i] |= data.rowMasks[orient[game]][i] << shift;
+    }
+
+    // Only rows of the piece can have been filled, so the rows below it are left in place.
+    int write = std::max(bottom, 0);
+    for (int row = write; row < 20; ++row) {
+        if (rows[row] != batchFullRow) {
+            rows[write++] = rows[row];
+        }
+    }
+    int cleared = 20 - write;
+    std::fill(rows + write, rows + 20, batchEmptyRow);
+    if (cleared == 0) {
+        phase[game] = phaseEntryDelay;
+        return;
+    }
+
+    lineCount[game] += cleared;
+    ++lineTypeCount[(cleared - 1)*numGames + game];
+    int32_t points = 0;
+    for (int type = 0; type < 4; ++type) {
+        points += linePoints[type] * lineTypeCount[type*numGames + game];
+    }
+    score[game] = points * (level[game] + 1);
+    reward += linePoints[cleared - 1] * (level[game] + 1);
+    if (lineCount[game] >= firstThreshold) {
+        level[game] = startLevel + (lineCount[game] - firstThreshold)/10 + 1;
+        setGravity[game] = getLevelConstants(level[game]).setGravity;
+    }
+    phase[game] = phaseLineClear;
+}
+
+void BatchNES::spawnPiece(int game)
+// This function takes a game's next piece from its generator, and ends the game if the piece overlaps the stack.
+{
+    piece[game] = generators[game].next();
+    nextPiece[game] = generators[game].peek(0);
+    orient[game] = 0;
+    pieceRow[game] = 19;
+    pieceCol[game] = 5;
+    phase[game] = collides(game, 0, 19, 5) ? phaseGameOver : phaseActive;
+}
+
+void BatchNES::observe(uint8_t* observations) const
+// This function writes the observation of every game, each laid out as in environment.hpp, one after another.
+{
+    for (int game = 0; game < numGames; ++game) {
+        uint8_t* observation = observations + game*observationSize;
+        const uint16_t* rows = &boards[game*batchRows + batchFloorRows];
+        for (int row = 0; row < 20; ++row) {
+            for (int col = 0; col < 10; ++col) {
+                observation[stackPlane + 10*row + col] = (rows[row] >> (col + batchWallBits)) & 1;
+            }
+        }
+        std::memset(observation + piecePlane, 0, observationCells);
+        if (phase[game] == phaseActive) {
+            for (const BlockCoord& offset : pieceTable[piece[game]].coordOffsets[orient[game]]) {
+                int row = pieceRow[game] + offset.first, col = pieceCol[game] + offset.second;
+                if (row >= 0 && row < 20 && col >= 0 && col < 10) {
+                    observation[piecePlane + 10*row + col] = 1;
+                }
+            }
+        }
+        uint8_t* scalars = observation + scalarOffset;
+        scalars[obsPiece] = piece[game];
+        scalars[obsNextPiece] = nextPiece[game];
+        scalars[obsLevel] = std::min(level[game], 255);
+        scalars[obsGravity] = setGravity[game];
+        scalars[obsDropFrames] = dropFrames[game];
+        scalars[obsDasFrames] = dasFrames[game];
+        scalars[obsPieceRow] = pieceRow[game];
+        scalars[obsPieceCol] = pieceCol[game];
+        scalars[obsPieceOrient] = orient[game];
+        scalars[obsPhase] = phase[game];
+    }
+}
@@ -32,7 +32,7 @@ void Board::placePiece(const Piece& piece)
  * the passed Piece class instance.  
  */
 {
-    grid.fillSet(piece.coords, piece.data.index);
+    grid.fillSet(piece.coords, piece.data->index);
     auto filledRows = grid.getFilledRows();
     if (!filledRows.empty()) {
         lineCount += filledRows.size();
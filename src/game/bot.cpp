@@ -0,0 +1,169 @@
+#include "game/bot.hpp"
+
+#include "game/nes.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/replay.hpp"
+#include "game/lookahead.hpp"
+#include "game/threadpool.hpp"
+#include "game/transposition.hpp"
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+BotPlayer::BotPlayer(const EvalWeights& weights, const InputModel& input) :
+/*
+ * The BotPlayer class plays NES Tetris by filling in the same commands that
+ * NESTetris::setCommands reads from an InputSource, so a game driven by the
+ * bot runs (and can be recorded) exactly like one driven by a player. When a
+ * piece spawns, the bot finds every placement that can be reached in time
+ * with its input model, scores the stack each one would leave with the
+ * evaluation weights, and then plays back the inputs of the best one frame
+ * by frame until the piece locks. With a thread pool, the bot also looks at
+ * the next piece, as described in searchLookahead, and with a transposition
+ * table it remembers the results of those searches.
+ */
+weights{weights}, // Weights of the evaluation function
+input{input}, // How the bot is allowed to press the direction buttons
+pool{nullptr}, // Threads for the two-piece lookahead, or nullptr to look at the current piece only
+budget{0}, // Seconds that the lookahead may spend on each piece
+table{nullptr}, // Results of earlier lookahead searches, or nullptr to search every position afresh
+evaluations{0}, // Number of placements scored so far, for benchmarking
+tableHits{0}, // Number of searches skipped thanks to the transposition table
+placements{}, // Reachable placements of the current piece, kept to reuse their capacity
+plan{}, // Packed commands for each active frame of the current piece
+planStep{0}, // Index in plan of the commands for the next active frame
+plannedMove{-1}, // The game's move count when the plan was made
+expectedFrame{-1} // The game's frame count on which the next commands of the plan are due
+{}
+
+void BotPlayer::useLookahead(ThreadPool& pool, double budget)
+// This function makes the bot look at the next piece too, spending at most about budget seconds per piece.
+{
+    this->pool = &pool;
+    this->budget = budget;
+}
+
+void BotPlayer::useTable(TranspositionTable& table)
+/*
+ * This function gives the bot a transposition table for its lookahead. The
+ * table must be cleared if it was last used with other weights or another
+ * input model, and it can be shared by bots running on different threads.
+ */
+{
+    this->table = &table;
+}
+
+void BotPlayer::reset()
+// This function discards the current plan, so that a new one is made on the next active frame.
+{
+    plan.clear();
+    planStep = 0;
+    plannedMove = -1;
+    expectedFrame = -1;
+}
+
+void BotPlayer::setCommands(NESTetris& game)
+/*
+ * This function sets the commands of the game for its next frame. No commands
+ * are given during entry delays, line clears, or after the game has topped
+ * out, since the game ignores them. Within a piece the active frames follow
+ * one another without a break, so a plan is made whenever a frame arrives
+ * that does not continue the current one: a new piece has spawned, or the
+ * game has been reset or restored.
+ */
+{
+    game.commands = NESCommands{};
+    if (game.flags.gameOver || game.flags.frozen || !game.filledRows.empty()) {
+        return;
+    }
+    if (game.dynamic.move != plannedMove || game.dynamic.totalFrames != expectedFrame) {
+        choosePlacement(game);
+    }
+    if (planStep < static_cast<int>(plan.size())) {
+        game.commands = unpackCommands(plan[planStep]);
+
+        /*
+         * The reachability search does not model the first piece's drop delay,
+         * so that piece is soft dropped on its first frame to end the delay. The
+         * drop counter starts at zero, so the halved gravity of that one frame
+         * does not change whether the piece drops on it.
+         */
+        if (planStep == 0 && game.flags.dropDelay) {
+            game.commands.softDrop = true;
+        }
+        ++planStep;
+    }
+    ++expectedFrame;
+}
+
+void BotPlayer::choosePlacement(const NESTetris& game)
+/*
+ * This function makes the plan for the game's current piece, which is the
+ * input sequence of the reachable placement with the highest score, looking
+ * at the next piece as well if the bot has a thread pool. Ties go to the
+ * placement found first. If no placement is reachable, the plan is empty and
+ * the piece is left to fall. The lookahead's budget is counted from here, so
+ * it includes finding the current piece's own placements, which is always
+ * finished even if that alone takes longer than the budget.
+ */
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(budget));
+    findTimedPlacements(game, input, placements);
+    int best = -1;
+    if (pool) {
+        /*
+         * A position that was searched in full before, with the same pieces, level
+         * and DAS counter, has the same reachable placements and the same best one,
+         * so only its inputs need to be found again.
+         */
+        uint64_t key = 0;
+        TableResult cached;
+        if (table) {
+            key = hashPosition(hashGrid(game.board.grid), game.currPiece.data->index,
+                game.nextPiece.data->index, game.dynamic.level, game.dynamic.dasFrames);
+            if (table->probe(key, cached)) {
+                for (int i = 0; i < static_cast<int>(placements.size()) && best == -1; ++i) {
+                    const Placement& placement = placements[i].placement;
+                    if (placement.orient == cached.placement.orient && placement.col == cached.placement.col &&
+                        placement.row == cached.placement.row) {
+                        best = i;
+                        ++tableHits;
+                    }
+                }
+            }
+        }
+        if (best == -1) {
+            LookaheadStats stats;
+            best = searchLookahead(game, placements, weights, input, *pool, deadline, table, stats);
+            evaluations += placements.size() + stats.leaves;
+            tableHits += stats.tableHits;
+            if (table && best != -1 && stats.searched == static_cast<int>(placements.size())) {
+                table->store(key, TableResult{0, placements[best].placement}); // Only the placement is read back
+            }
+        }
+    }
+    else {
+        const Grid& grid = game.board.grid;
+        const PieceData& data = *game.currPiece.data;
+        double bestScore = 0;
+        for (int i = 0; i < static_cast<int>(placements.size()); ++i) {
+            double score = evaluatePlacement(grid, data, placements[i].placement, weights);
+            if (best == -1 || score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+        evaluations += placements.size();
+    }
+
+    plan.clear();
+    if (best != -1) {
+        plan.assign(placements[best].inputs.begin(), placements[best].inputs.end());
+    }
+    planStep = 0;
+    plannedMove = game.dynamic.move;
+    expectedFrame = game.dynamic.totalFrames;
+}
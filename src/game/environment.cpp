@@ -0,0 +1,225 @@
+#include "game/environment.hpp"
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+#include "game/grid.hpp"
+#include "game/reach.hpp"
+#include "game/replay.hpp"
+#include "game/evaluate.hpp"
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+
+NESEnvironment::NESEnvironment(int startLevel, RandomMode mode, uint8_t* observation) :
+/*
+ * The NESEnvironment class wraps an NESTetris game in the reset/step interface
+ * used by reinforcement learning libraries. Observations are written straight
+ * into a buffer of observationSize bytes owned by the caller (for example a
+ * row of a NumPy array), which is never reallocated or copied. Rather than
+ * being rewritten on every step, the buffer is patched: only board rows that
+ * changed, the cells the falling piece left and entered, and the scalars are
+ * written. The buffer must therefore not be modified by the caller between
+ * steps.
+ *
+ * There are two kinds of step. A frame step holds a set of controller buttons
+ * for one frame, which are turned into commands just as NESTetris::setCommands
+ * turns keys into commands. A placement step plays the inputs of one of the
+ * placements returned by getPlacements, then runs the game up to the frame on
+ * which the next piece can move. The reward of a step is the number of points
+ * earned by its line clears, at the level they were cleared on.
+ */
+game{startLevel, 0, mode}, // The game being played
+input{dasInput()}, // How placement steps shift pieces, which can be changed before a reset
+observation{observation}, // Buffer that observations are written to
+prevButtons{0}, // Buttons held on the previous frame step, to tell presses from holds
+spawnFrame{0}, // Frame count on which the current piece first became able to move
+placementsFrame{-1}, // Value of spawnFrame when placements was last found
+shownRows{}, // Rows of the stack as they are currently written in the buffer
+shownPiece{}, // Blocks of the falling piece as they are currently written in the buffer
+pieceShown{false}, // Whether shownPiece is written in the buffer
+placements{} // Reachable placements of the current piece, kept to reuse their capacity
+{}
+
+const uint8_t* NESEnvironment::reset(uint32_t seed)
+// This function starts a new game whose pieces are fixed by the seed, and returns its first observation.
+{
+    game.pieceGen.seed(seed);
+    game.resetGame();
+    prevButtons = 0;
+    spawnFrame = game.dynamic.totalFrames;
+    placementsFrame = -1;
+    std::memset(observation, 0, observationSize);
+    shownRows.fill(0);
+    pieceShown = false;
+    writeObservation();
+    return observation;
+}
+
+StepResult NESEnvironment::step(uint8_t buttons)
+/*
+ * This function runs one frame with the passed controller buttons held (an OR
+ * of ControllerButton values). A button that was not held on the previous step
+ * counts as pressed, and one that was counts as held, so that tapping needs a
+ * step without the button in between.
+ */
+{
+    uint8_t pressed = buttons & ~prevButtons, held = buttons & prevButtons;
+    NESCommands commands{};
+    commands.doCCW = (pressed & buttonA) && !(buttons & buttonB);
+    commands.doCW = (pressed & buttonB) && !(buttons & buttonA);
+    commands.doLeft = (pressed & buttonLeft) && !(buttons & buttonRight);
+    commands.leftDAS = held & buttonLeft;
+    commands.doRight = (pressed & buttonRight) && !(buttons & buttonLeft);
+    commands.rightDAS = held & buttonRight;
+    commands.softDrop = buttons & buttonDown;
+    prevButtons = buttons;
+
+    StepResult result{0, false, StepInfo{0, 0, false}};
+    runFrame(commands, result);
+    result.done = game.flags.gameOver;
+    writeObservation();
+    return result;
+}
+
+StepResult NESEnvironment::stepPlacement(int placement)
+/*
+ * This function plays the placement at the passed index of getPlacements,
+ * and then runs the game until the next piece can move or the game is over.
+ * It can only be called on the first frame of a piece, before any frame step
+ * has moved it. Like BotPlayer, it soft drops on the first frame of the game
+ * to end the drop delay of the first piece, which the placements ignore.
+ */
+{
+    StepResult result{0, game.flags.gameOver, StepInfo{0, 0, false}};
+    if (result.done) {
+        return result;
+    }
+    const std::vector<TimedPlacement>& options = getPlacements();
+    if (placement < 0 || placement >= static_cast<int>(options.size())) {
+        std::cout << "Error: placement " << placement << " is not one of the " << options.size() <<
+            " reachable placements" << std::endl;
+        return result;
+    }
+    const std::vector<uint8_t>& inputs = options[placement].inputs;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        NESCommands commands = unpackCommands(inputs[i]);
+        if (i == 0 && game.flags.dropDelay) {
+            commands.softDrop = true;
+        }
+        runFrame(commands, result);
+    }
+
+    // The piece should have locked on the last input, but if it has not it is left to fall.
+    while (!result.info.locked && !game.flags.gameOver) {
+        runFrame(NESCommands{}, result);
+    }
+    skipToPiece(result);
+    prevButtons = 0;
+    result.done = game.flags.gameOver;
+    writeObservation();
+    return result;
+}
+
+const std::vector<TimedPlacement>& NESEnvironment::getPlacements()
+/*
+ * This function returns the placements of the current piece that can be
+ * reached with the input model from the frame it spawned on. The list is only
+ * filled on that frame, once per piece, and is empty on any other frame.
+ */
+{
+    if (getPhase() != phaseActive || game.dynamic.totalFrames != spawnFrame) {
+        placements.clear();
+        placementsFrame = -1;
+    }
+    else if (placementsFrame != spawnFrame) {
+        findTimedPlacements(game, input, placements);
+        placementsFrame = spawnFrame;
+    }
+    return placements;
+}
+
+void NESEnvironment::runFrame(const NESCommands& commands, StepResult& result)
+// This function runs one frame of the game and adds its line clears, reward, and lock to the result.
+{
+    std::array<int, 4> points{game.lineScore[0], game.lineScore[1], game.lineScore[2], game.lineScore[3]};
+    int lines = game.board.lineCount, move = game.dynamic.move;
+    bool active = getPhase() == phaseActive;
+    game.runFrame(commands);
+    int cleared = game.board.lineCount - lines;
+    if (cleared > 0) {
+        result.reward += points[cleared - 1];
+        result.info.lines += cleared;
+    }
+    result.info.locked |= game.dynamic.move != move;
+    ++result.info.frames;
+    if (!active && getPhase() == phaseActive) {
+        spawnFrame = game.dynamic.totalFrames;
+    }
+}
+
+void NESEnvironment::skipToPiece(StepResult& result)
+// This function runs the entry delay and line clear frames that follow a lock, in which no input is read.
+{
+    while (getPhase() == phaseEntryDelay || getPhase() == phaseLineClear) {
+        runFrame(NESCommands{}, result);
+    }
+}
+
+void NESEnvironment::writeObservation()
+// This function brings the observation buffer up to date with the game, writing only what has changed.
+{
+    const Grid& grid = game.board.grid;
+    for (int row = 0; row < 20; ++row) {
+        uint16_t changed = grid.rows[row] ^ shownRows[row];
+        if (changed) {
+            uint8_t* cells = observation + stackPlane + 10*row;
+            for (int col = 0; col < 10; ++col) {
+                cells[col] = (grid.rows[row] >> col) & 1;
+            }
+            shownRows[row] = grid.rows[row];
+        }
+    }
+
+    uint8_t* piece = observation + piecePlane;
+    if (pieceShown) {
+        for (const BlockCoord& block : shownPiece) {
+            if (block.first >= 0 && block.first < 20 && block.second >= 0 && block.second < 10) {
+                piece[10*block.first + block.second] = 0;
+            }
+        }
+    }
+    uint8_t phase = getPhase();
+    pieceShown = (phase == phaseActive);
+    if (pieceShown) {
+        shownPiece = game.currPiece.coords;
+        for (const BlockCoord& block : shownPiece) {
+            if (block.first >= 0 && block.first < 20 && block.second >= 0 && block.second < 10) {
+                piece[10*block.first + block.second] = 1;
+            }
+        }
+    }
+
+    uint8_t* scalars = observation + scalarOffset;
+    scalars[obsPiece] = game.currPiece.data->index;
+    scalars[obsNextPiece] = game.nextPiece.data->index;
+    scalars[obsLevel] = (game.dynamic.level > 255) ? 255 : game.dynamic.level;
+    scalars[obsGravity] = game.constants.setGravity;
+    scalars[obsDropFrames] = (game.dynamic.dropFrames > 255) ? 255 : game.dynamic.dropFrames;
+    scalars[obsDasFrames] = game.dynamic.dasFrames;
+    scalars[obsPieceRow] = game.currPiece.centerRow;
+    scalars[obsPieceCol] = game.currPiece.centerCol;
+    scalars[obsPieceOrient] = game.currPiece.orient;
+    scalars[obsPhase] = phase;
+}
+
+uint8_t NESEnvironment::getPhase() const
+// This function returns which kind of frame the game will run next.
+{
+    if (game.flags.gameOver) return phaseGameOver;
+    if (game.flags.frozen) return phaseEntryDelay;
+    if (!game.filledRows.empty()) return phaseLineClear;
+    return phaseActive;
+}
@@ -0,0 +1,218 @@
+#include "game/evaluate.hpp"
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+
+#include <map>
+#include <string>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdint>
+
+/*
+ * The functions below score the stack left behind by a placement, for bots
+ * that pick their moves by trying every placement and keeping the best one.
+ * They work only on the occupancy masks of the rows (never on a full Grid or
+ * Board), so a placement can be scored in well under a microsecond: the
+ * piece's row masks are ORed into a copy of the rows, full rows are removed,
+ * and the features are then read off with a single pass from the top of the
+ * stack down.
+ */
+
+EvalWeights defaultWeights()
+/*
+ * This function returns the weights used when no weights file is given. They
+ * favor a low, flat stack without holes, keep one deep well for the I piece,
+ * and prefer Tetrises to smaller clears.
+ */
+{
+    EvalWeights weights{};
+    weights.holes = -8.0;
+    weights.bumpiness = -1.0;
+    weights.wellDepth = -1.5;
+    weights.aggregateHeight = -1.0;
+    weights.maxHeight = -1.0;
+    weights.unfitPieces = -3.0;
+    weights.singles = -6.0;
+    weights.doubles = -4.0;
+    weights.triples = -2.0;
+    weights.tetrises = 10.0;
+    return weights;
+}
+
+bool loadWeights(const std::string& filePath, EvalWeights& weights)
+/*
+ * This function reads evaluation weights from a text file. Each line holds a
+ * weight name from weightNames followed by its value, such as "holes -8", and
+ * anything after a '#' is ignored. Weights that are not listed keep the values
+ * they had when passed in. If the file cannot be read or names an unknown
+ * weight, an error is printed and false is returned.
+ */
+{
+    std::ifstream weightFile(filePath);
+    if (!weightFile.good()) {
+        std::cout << "Error: Unable to open weights file " << filePath << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(weightFile, line)) {
+        std::istringstream lineStream(line.substr(0, line.find('#')));
+        std::string name;
+        if (!(lineStream >> name)) {
+            continue; // Blank or comment line
+        }
+        auto nameItr = weightNames.find(name);
+        double value = 0;
+        if (nameItr == weightNames.end() || !(lineStream >> value)) {
+            std::cout << "Error: Invalid weight \"" << line << "\" in " << filePath << std::endl;
+            return false;
+        }
+        weights.*(nameItr->second) = value;
+    }
+    return true;
+}
+
+int placeOnStack(const Grid& grid, const PieceData& data, const Placement& placement, StackRows& rows)
+/*
+ * This function copies the rows of the grid into rows, places the piece there,
+ * and removes any rows that it fills, returning the number of lines cleared.
+ * Blocks above the top of the grid are dropped, as Grid::fill does. The
+ * placement is assumed to be a valid resting position.
+ */
+{
+    rows = grid.rows;
+    const BoundingBox& box = data.bounds[placement.orient];
+    int bottomRow = placement.row + box.minRow;
+    int leftCol = placement.col + box.minCol;
+    int lines = 0;
+    for (int i = 0; i <= box.maxRow - box.minRow; ++i) {
+        int row = bottomRow + i;
+        if (row < grid.height) {
+            rows[row] |= data.rowMasks[placement.orient][i] << leftCol;
+            lines += rows[row] == grid.fullRow;
+        }
+    }
+    if (lines) {
+        // Rows above the lowest cleared row shift down over the cleared ones.
+        int write = bottomRow;
+        for (int read = bottomRow; read < grid.height; ++read) {
+            if (rows[read] != grid.fullRow) {
+                rows[write++] = rows[read];
+            }
+        }
+        for (; write < grid.height; ++write) {
+            rows[write] = 0;
+        }
+    }
+    return lines;
+}
+
+BoardFeatures getFeatures(const StackRows& rows, int height, int width, int linesCleared)
+/*
+ * This function measures the features of a stack. Heights and holes are found
+ * by sweeping down the rows while keeping a mask of the columns covered so far.
+ * The surface is then described by the steps between neighboring columns, in
+ * the same form as the bottomSurf contours of the pieces, so a piece fits
+ * cleanly wherever its contour matches a run of surface steps.
+ */
+{
+    BoardFeatures features{};
+    features.linesCleared = linesCleared;
+
+    std::array<int, Grid::maxWidth> heights{};
+    uint32_t covered = 0;
+    for (int row = height - 1; row >= 0; --row) {
+        uint32_t rowMask = rows[row];
+        features.holes += __builtin_popcount(covered & ~rowMask);
+        uint32_t fresh = rowMask & ~covered;
+        while (fresh) {
+            heights[__builtin_ctz(fresh)] = row + 1;
+            fresh &= fresh - 1;
+        }
+        covered |= rowMask;
+    }
+
+    // stepMasks[step + 2] has bit col set if the surface rises by step from column col to col + 1.
+    std::array<uint32_t, 5> stepMasks{};
+    for (int col = 0; col < width; ++col) {
+        int colHeight = heights[col];
+        features.aggregateHeight += colHeight;
+        features.maxHeight = (colHeight > features.maxHeight) ? colHeight : features.maxHeight;
+        int left = (col > 0) ? heights[col - 1] : Grid::maxHeight;
+        int right = (col < width - 1) ? heights[col + 1] : Grid::maxHeight;
+        int depth = ((left < right) ? left : right) - colHeight;
+        features.wellDepth += (depth > 0) ? depth : 0;
+        if (col < width - 1) {
+            int step = heights[col + 1] - colHeight;
+            features.bumpiness += (step < 0) ? -step : step;
+            if (step >= -2 && step <= 2) {
+                stepMasks[step + 2] |= 1u << col;
+            }
+        }
+    }
+
+    for (unsigned int index = 1; index < pieceTable.size(); ++index) {
+        const PieceData& data = pieceTable[index];
+        bool fits = false;
+        for (int orient = 0; orient < data.numOrients && !fits; ++orient) {
+            // The contour of a piece spanning n columns has n - 1 steps, with one position per starting column.
+            int span = data.bounds[orient].maxCol - data.bounds[orient].minCol;
+            uint32_t positions = (1u << (width - span)) - 1;
+            for (int step = 0; step < span; ++step) {
+                int rise = data.bottomSurf[orient].steps[step];
+                positions &= (rise >= -2 && rise <= 2) ? stepMasks[rise + 2] >> step : 0;
+            }
+            fits = positions != 0;
+        }
+        features.unfitPieces += !fits;
+    }
+    return features;
+}
+
+double scoreLines(int linesCleared, const EvalWeights& weights)
+// This function returns the weight of a line clear of the passed size (zero for no clear).
+{
+    const double lineWeights[5] = {0, weights.singles, weights.doubles, weights.triples, weights.tetrises};
+    return lineWeights[linesCleared];
+}
+
+double scoreFeatures(const BoardFeatures& features, const EvalWeights& weights)
+// This function returns the weighted sum of the features, where higher scores are better.
+{
+    return weights.holes*features.holes +
+        weights.bumpiness*features.bumpiness +
+        weights.wellDepth*features.wellDepth +
+        weights.aggregateHeight*features.aggregateHeight +
+        weights.maxHeight*features.maxHeight +
+        weights.unfitPieces*features.unfitPieces +
+        scoreLines(features.linesCleared, weights);
+}
+
+double evaluatePlacement(const Grid& grid, const PieceData& data, const Placement& placement,
+    const EvalWeights& weights)
+// This function returns the score of the stack left by placing the piece on the grid.
+{
+    StackRows rows;
+    int lines = placeOnStack(grid, data, placement, rows);
+    return scoreFeatures(getFeatures(rows, grid.height, grid.width, lines), weights);
+}
+
+/*
+ * The following map names each weight, which is how they are referred to in
+ * weights files.
+ */
+
+const std::map<const std::string, double EvalWeights::*> weightNames{
+    {"holes", &EvalWeights::holes},
+    {"bumpiness", &EvalWeights::bumpiness},
+    {"wellDepth", &EvalWeights::wellDepth},
+    {"aggregateHeight", &EvalWeights::aggregateHeight},
+    {"maxHeight", &EvalWeights::maxHeight},
+    {"unfitPieces", &EvalWeights::unfitPieces},
+    {"singles", &EvalWeights::singles},
+    {"doubles", &EvalWeights::doubles},
+    {"triples", &EvalWeights::triples},
+    {"tetrises", &EvalWeights::tetrises}};
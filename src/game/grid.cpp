@@ -1,45 +1,70 @@
 #include "game/grid.hpp"
 
 #include <vector>
+#include <array>
 #include <algorithm>
+#include <cstdint>
 
 Grid::Grid(const int height, const int width) :
 /*
  * The Grid class stores and manipulates the Tetris playfield, recording
  * piece placements and checking for collisions. It is generally encapsulated
  * in a Board instance which controls piece placement, but can exist independently.
- * The playfield is stored in a vector of vectors, where the elements of the inner
- * vectors are positive integers with meaning dictated by the game mode. 
+ * The playfield is stored as a bitboard: each row is a 16-bit occupancy mask where
+ * bit c is set if column c is filled, which lets row and collision queries be done
+ * with a handful of integer operations. The positive integers whose meaning is
+ * dictated by the game mode (piece indices, highlight colors) are kept separately
+ * in a flat color plane that is only read when the actual values are needed. Both
+ * planes are fixed-size arrays, so the grid never touches the heap and copying it
+ * is a single block copy. Dimensions larger than maxHeight x maxWidth are clamped.
  */
-height{height},
-width{width}
+height{std::min(height, maxHeight)},
+width{std::min(width, maxWidth)},
+fullRow{static_cast<uint16_t>((1u << std::min(width, maxWidth)) - 1)}, // Mask of a completely filled row
+rows{}, // Occupancy mask for each row, indexed from the bottom
+colors{} // Index value of each block, stored row by row with a stride of maxWidth
 {
     clear(); // Generate grids
 }
 
-int Grid::get(const int row, const int col)
+int Grid::get(const int row, const int col) const
 /*
  * This function returns the value at the specified grid position. If the row/col 
  * is negative or beyond the height/width of the grid, -1 is returned to indicate 
  * failure.
  */
 {
-    return inBounds(row, col) ? grid[row][col] : -1;
+    return inBounds(row, col) ? colors[row*maxWidth + col] : -1;
+}
+
+uint16_t Grid::getRow(const int row) const
+/*
+ * This function returns the occupancy mask of the specified row. Rows
+ * outside of the grid are reported as empty.
+ */
+{
+    return (row >= 0 && row < height) ? rows[row] : 0;
 }
 
 void Grid::fill(int row, int col, unsigned int index)
 /*
  * This function assigns the passed index value to the specified position
- * on the grid. If the requested position is out of bounds, then the
- * function call has no effect. 
+ * on the grid, setting or clearing the matching occupancy bit. If the
+ * requested position is out of bounds, then the function call has no effect.
  */
 {
     if (inBounds(row, col)) {
-        grid[row][col] = index;
+        colors[row*maxWidth + col] = index;
+        if (index) {
+            rows[row] |= (1u << col);
+        }
+        else {
+            rows[row] &= ~(1u << col);
+        }
     }
 }
 
-void Grid::fillSet(const std::vector<std::vector<int>>& coords, unsigned int index)
+void Grid::fillSet(const PieceCoords& coords, unsigned int index)
 /*
  * This function calls the fill method for a set of coordinates that all share
  * the same index. This is intended for the kind of bulk grid assingment that
@@ -47,7 +72,7 @@ void Grid::fillSet(const std::vector<std::vector<int>>& coords, unsigned int ind
  */
 {
     for (const auto& rowCol : coords) {
-        fill(rowCol[0], rowCol[1], index);
+        fill(rowCol.first, rowCol.second, index);
     }  
 }
 
@@ -55,32 +80,33 @@ void Grid::clearRows(std::vector<int> filledRows)
 /*
  * This function deletes the rows indexed in the filledRows argument
  * and shifts the remaining rows down so that there aren't any gaps. The
- * algorithm works by going through each row and counting the number of 
- * filled rows that are lower. This determines how far down the row is going
- * to fall after the filled rows are removed. The row vectors corresponding to
- * the original position and final position are then swapped, shifting the
- * contents down. The topmost rows do not have anything above them and are 
- * therefore cleared.  
+ * algorithm walks up the grid with a separate write position that only
+ * advances for rows which are kept, so each surviving row is copied
+ * (mask and colors) directly to its final position. The topmost rows do
+ * not have anything above them and are therefore cleared.
  */
 {
     std::sort(filledRows.begin(), filledRows.end());
-    int numFilled = filledRows.size();
+    auto filledItr = filledRows.begin();
+    int writeRow = 0;
     for (int row = 0; row < height; ++row) {
-        int fallPosition = row; // This will hold the index of the row's final position
-        for (auto rowNum : filledRows) {
-            if (rowNum < row) {--fallPosition;}
-            if (rowNum == row) {fallPosition = row;} // If the row is filled, it's not swapped
+        while (filledItr != filledRows.end() && *filledItr < row) {++filledItr;}
+        if (filledItr != filledRows.end() && *filledItr == row) {continue;} // Deleted rows are skipped
+        if (writeRow != row) {
+            rows[writeRow] = rows[row];
+            std::copy_n(&colors[row*maxWidth], width, &colors[writeRow*maxWidth]);
         }
-        if (fallPosition < row) {grid[row].swap(grid[fallPosition]);}
-        if (row >= height - numFilled) { // Clear the topmost rows which don't have anything above them
-            std::fill(grid[row].begin(), grid[row].end(), 0);
-        }   
+        ++writeRow;
+    }
+    for (int row = writeRow; row < height; ++row) { // Clear the topmost rows which don't have anything above them
+        rows[row] = 0;
+        std::fill_n(&colors[row*maxWidth], width, 0);
     }
 }
 
-bool Grid::collisionCheck(const std::vector<std::vector<int>>& coords)
+bool Grid::collisionCheck(const PieceCoords& coords) const
 /*
- * This function checks to see if any of the passed coordinates, which 
+ * This function checks to see if any of the passed (row, col) coordinates, which
  * generally represent a piece, overlap with floor, side-walls, or previous 
  * pieces. Collision with the ceiling is not checked, since in Tetris parts 
  * of a piece are usually allowed to exist above the playfiled so that the 
@@ -89,8 +115,8 @@ bool Grid::collisionCheck(const std::vector<std::vector<int>>& coords)
 {
     bool collision = false;
     for (auto& rowCol : coords) {
-        bool wallCollide = rowCol[0] < 0 || rowCol[1] < 0 || rowCol[1] >= width;
-        bool pieceCollide = rowCol[0] < height && get(rowCol[0], rowCol[1]);
+        bool wallCollide = rowCol.first < 0 || rowCol.second < 0 || rowCol.second >= width;
+        bool pieceCollide = !wallCollide && rowCol.first < height && ((rows[rowCol.first] >> rowCol.second) & 1);
         if (wallCollide || pieceCollide) {
             collision = true;
         }
@@ -98,27 +124,47 @@ bool Grid::collisionCheck(const std::vector<std::vector<int>>& coords)
     return collision;
 }
 
-std::vector<std::vector<int>> Grid::getFilledBlocks()
+bool Grid::collisionCheck(int bottomRow, const std::array<uint16_t, 4>& rowMasks) const
+/*
+ * This function is the bitboard form of the collision check. Each element
+ * of rowMasks is the occupancy mask of a piece for one row, starting at
+ * bottomRow and moving up, already shifted into its column position. A
+ * collision occurs if a mask overlaps the row beneath it, extends past the
+ * right wall, or lies below the floor. As above, the ceiling is not checked.
+ * Masks cannot represent columns left of the wall, so callers need to check
+ * the left edge of the piece themselves.
+ */
+{
+    for (int i = 0; i < 4; ++i) {
+        uint16_t mask = rowMasks[i];
+        if (!mask) {continue;}
+        int row = bottomRow + i;
+        if (row < 0 || (mask & ~fullRow)) {return true;}
+        if (row < height && (rows[row] & mask)) {return true;}
+    }
+    return false;
+}
+
+std::vector<std::vector<int>> Grid::getFilledBlocks() const
 /*
  * This function finds the positions and indices of all filled blocks,
  * returning a container of vector tuples giving the row, column, and 
- * index value.  
+ * index value. Empty rows are skipped using their occupancy masks.
  */
 {
     std::vector<std::vector<int>> filledBlocks;
     for (int row = 0; row < height; ++row) {
-        for (int col = 0; col < width; ++col) {
-            auto index = grid[row][col];
-            if (index) { // Unfilled blocks have index 0
-                filledBlocks.push_back(std::vector<int>{row, col, index});
+        uint16_t mask = rows[row];
+        for (int col = 0; mask; ++col, mask >>= 1) {
+            if (mask & 1) { // Unfilled blocks have index 0
+                filledBlocks.push_back(std::vector<int>{row, col, colors[row*maxWidth + col]});
             }
-            
         }
     }
     return filledBlocks;
 }
 
-bool Grid::inBounds(const int row, const int col)
+bool Grid::inBounds(const int row, const int col) const
 /*
  * This function checks if a given row/column pair is within
  * the boundaries of the grid (i.e. non-negative and less than
@@ -129,7 +175,7 @@ bool Grid::inBounds(const int row, const int col)
     return row >= 0 && row < height && col >= 0 && col < width;
 }
 
-std::vector<int> Grid::getFilledRows()
+std::vector<int> Grid::getFilledRows() const
 /*
  * This function returns the set of indices corresponding to rows 
  * which are completely filled, meaning that all of their indices 
@@ -139,8 +185,7 @@ std::vector<int> Grid::getFilledRows()
 {
     std::vector<int> filledRows;
     for (int row = 0; row < height; ++row) {
-        auto vec = grid[row];
-        if (std::all_of(vec.begin(), vec.end(), [] (int val) {return val != 0;})) {
+        if (rows[row] == fullRow) {
             filledRows.push_back(row);
         }
     }
@@ -153,5 +198,6 @@ void Grid::clear()
  * to a grid of empty blocks. 
  */ 
 {
-    grid = std::vector<std::vector<int>>(height, std::vector<int>(width, 0));
+    rows.fill(0);
+    colors.fill(0);
 }
@@ -0,0 +1,191 @@
+#include "game/history.hpp"
+
+#include "game/board.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <algorithm>
+
+MoveHistory::MoveHistory(const Board& startBoard, int keyframeInterval) :
+/*
+ * The MoveHistory class records the positions of a game as a tree, so that
+ * the player can go back to an earlier position, try a different move, and
+ * still switch back to the line they played before. Each node of the tree is
+ * one position and stores only the piece placed to reach it (a four-byte
+ * MoveRecord) and the links to its parent, children, and siblings, so lines
+ * that branch off from the same position share all of the nodes before it.
+ * A full Board is only stored at every keyframeInterval-th depth, and any
+ * position is rebuilt by copying the Board of its nearest keyframe ancestor
+ * and placing the pieces of the moves in between. Node 0 is the position
+ * before the first move, and current is the node being viewed.
+ */
+current{0}, // The node of the position currently being viewed
+keyframeInterval{std::max(keyframeInterval, 1)}, // Number of moves between stored Boards
+nodes{}, // All positions of every line, with links between them held as node indices
+keyframes{} // The Boards of nodes whose depth is a multiple of keyframeInterval
+{
+    reset(startBoard);
+}
+
+void MoveHistory::reset(const Board& startBoard)
+/*
+ * This function erases the history and starts a new one from the passed
+ * Board. The containers keep their capacity, so resetting does not allocate.
+ */
+{
+    nodes.clear();
+    keyframes.clear();
+    keyframes.push_back(startBoard);
+    nodes.push_back(MoveNode{MoveRecord{0, 0, 0, 0}, -1, -1, -1, -1, 0, 0});
+    current = 0;
+}
+
+void MoveHistory::push(const Piece& piece, const Board& result)
+/*
+ * This function records a move made from the current position, given the
+ * piece that was placed and the Board that resulted from placing it, and
+ * makes the new position current. If the same move was already made from
+ * this position, the existing node is reused rather than duplicated. Otherwise
+ * a new variation is added after the existing ones, so nothing is discarded.
+ * The resulting Board is only kept if the new position needs a keyframe.
+ */
+{
+    MoveRecord move{static_cast<uint8_t>(piece.data->index), static_cast<int8_t>(piece.centerRow),
+        static_cast<int8_t>(piece.centerCol), static_cast<uint8_t>(piece.orient)};
+    int lastChild = -1;
+    for (int child = nodes[current].firstChild; child != -1; child = nodes[child].nextSibling) {
+        const MoveRecord& other = nodes[child].move;
+        if (other.index == move.index && other.centerRow == move.centerRow &&
+            other.centerCol == move.centerCol && other.orient == move.orient) {
+            nodes[current].activeChild = child;
+            current = child;
+            return;
+        }
+        lastChild = child;
+    }
+
+    int node = nodes.size();
+    int depth = nodes[current].depth + 1;
+    int keyframe = -1;
+    if (depth % keyframeInterval == 0) {
+        keyframe = keyframes.size();
+        keyframes.push_back(result);
+    }
+    nodes.push_back(MoveNode{move, current, -1, -1, -1, depth, keyframe});
+    if (lastChild == -1) {
+        nodes[current].firstChild = node;
+    }
+    else {
+        nodes[lastChild].nextSibling = node;
+    }
+    nodes[current].activeChild = node;
+    current = node;
+}
+
+bool MoveHistory::back()
+// This function moves to the parent of the current position, returning false if there is none.
+{
+    if (nodes[current].parent == -1) {
+        return false;
+    }
+    current = nodes[current].parent;
+    return true;
+}
+
+bool MoveHistory::forward()
+/*
+ * This function moves to a child of the current position, returning false
+ * if there is none. The child chosen is the one most recently visited, so
+ * going back and then forward again stays on the same line.
+ */
+{
+    if (nodes[current].activeChild == -1) {
+        return false;
+    }
+    current = nodes[current].activeChild;
+    return true;
+}
+
+bool MoveHistory::switchVariation(int step)
+/*
+ * This function moves to a sibling of the current position, i.e. a different
+ * move made from the same parent position, with step giving how many
+ * variations to move over (negative steps move to earlier variations). The
+ * function returns false and stays put if there is no such sibling.
+ */
+{
+    int parent = nodes[current].parent;
+    if (parent == -1 || step == 0) {
+        return false;
+    }
+    int position = 0;
+    for (int child = nodes[parent].firstChild; child != current; child = nodes[child].nextSibling) {
+        ++position;
+    }
+    int target = position + step;
+    if (target < 0 || target >= getVariationCount(current)) {
+        return false;
+    }
+    int child = nodes[parent].firstChild;
+    for (int i = 0; i < target; ++i) {
+        child = nodes[child].nextSibling;
+    }
+    nodes[parent].activeChild = child;
+    current = child;
+    return true;
+}
+
+int MoveHistory::size() const
+// This function returns the number of positions stored across all lines.
+{
+    return nodes.size();
+}
+
+int MoveHistory::getDepth(int node) const
+// This function returns the number of moves made to reach the passed position.
+{
+    return nodes[node].depth;
+}
+
+int MoveHistory::getVariationCount(int node) const
+// This function returns the number of moves made from the parent of the passed position (1 for the root).
+{
+    int parent = nodes[node].parent;
+    if (parent == -1) {
+        return 1;
+    }
+    int count = 0;
+    for (int child = nodes[parent].firstChild; child != -1; child = nodes[child].nextSibling) {
+        ++count;
+    }
+    return count;
+}
+
+Piece MoveHistory::getPiece(int node) const
+// This function returns the piece placed to reach the passed position, in its placed position.
+{
+    const MoveRecord& record = nodes[node].move;
+    Piece piece{pieceTable[record.index]};
+    piece.setPosition(record.centerRow, record.centerCol, record.orient);
+    return piece;
+}
+
+Board MoveHistory::getBoard(int node) const
+/*
+ * This function rebuilds the Board at the passed position. The path up to the
+ * nearest keyframe ancestor is at most keyframeInterval - 1 moves long, so the
+ * cost of the rebuild does not depend on the size of the tree.
+ */
+{
+    std::vector<int> path;
+    path.reserve(keyframeInterval);
+    while (nodes[node].keyframe == -1) {
+        path.push_back(node);
+        node = nodes[node].parent;
+    }
+    Board board = keyframes[nodes[node].keyframe];
+    for (auto itr = path.rbegin(); itr != path.rend(); ++itr) {
+        board.placePiece(getPiece(*itr));
+    }
+    return board;
+}
@@ -12,6 +12,8 @@ const std::map<const std::string, const int> keyToInt{
     {"s", GLFW_KEY_S},
     {"z", GLFW_KEY_Z},
     {"x", GLFW_KEY_X},
+    {"c", GLFW_KEY_C},
+    {"v", GLFW_KEY_V},
     {"left", GLFW_KEY_LEFT},
     {"right", GLFW_KEY_RIGHT},
     {"down", GLFW_KEY_DOWN},
@@ -40,6 +42,8 @@ prevQueried{ // Records whether the state of a button has previously been querie
     {GLFW_KEY_S, false},
     {GLFW_KEY_Z, false},
     {GLFW_KEY_X, false},
+    {GLFW_KEY_C, false},
+    {GLFW_KEY_V, false},
     {GLFW_KEY_LEFT, false},
     {GLFW_KEY_RIGHT, false},
     {GLFW_KEY_DOWN, false},
@@ -51,6 +55,8 @@ actionMap{ // Records the current state of the key as reported by the hardware
     {GLFW_KEY_S, 0},
     {GLFW_KEY_Z, 0},
     {GLFW_KEY_X, 0},
+    {GLFW_KEY_C, 0},
+    {GLFW_KEY_V, 0},
     {GLFW_KEY_LEFT, 0},
     {GLFW_KEY_RIGHT, 0},
     {GLFW_KEY_DOWN,0},
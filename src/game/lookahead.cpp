@@ -0,0 +1,137 @@
+#include "game/lookahead.hpp"
+
+#include "game/nes.hpp"
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/threadpool.hpp"
+#include "game/transposition.hpp"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cstdint>
+
+/*
+ * The counts kept by one worker during a search. Each worker's counts take up
+ * a whole cache line, so that workers updating their own counts never write
+ * to a line that another worker is using.
+ */
+struct alignas(64) WorkerCounts
+{
+    long leaves, hits;
+};
+
+int searchLookahead(const NESTetris& game, const std::vector<TimedPlacement>& placements,
+    const EvalWeights& weights, const InputModel& input, ThreadPool& pool,
+    std::chrono::steady_clock::time_point deadline, TranspositionTable* table, LookaheadStats& stats)
+/*
+ * This function picks a placement for the game's current piece by looking one
+ * piece ahead, returning its index in placements (the reachable placements of
+ * the current piece) or -1 if there are none. Each placement is scored by the
+ * best stack that the next piece can then leave, using the placements of the
+ * next piece that can be reached in time from its own spawn. Its DAS counter
+ * is taken to start from zero, since the counter it actually starts with
+ * depends on inputs that have not been chosen yet. A next piece that cannot
+ * spawn scores below everything else, since the game would end.
+ *
+ * Each placement of the current piece is one task for the thread pool, and
+ * the tasks share nothing but their read-only inputs, with every task writing
+ * its result into its own slot. Once the deadline has passed no new tasks are
+ * started, and the reachability searches of running tasks are abandoned.
+ * Placements are searched in order of their one-piece score, so the most
+ * promising ones are covered first, and only placements whose search was
+ * finished are compared. If none were finished, the best one-piece score is
+ * used instead.
+ *
+ * If a transposition table is passed, the best follow-up of each board and
+ * next piece is looked up there before it is searched, and stored after. The
+ * follow-up scores are rounded to the precision of the table either way, so
+ * the result does not depend on which searches happened to be cached.
+ */
+{
+    auto start = std::chrono::steady_clock::now();
+    stats = LookaheadStats{0, 0, 0, 0};
+    int numPlacements = placements.size();
+    if (numPlacements == 0) {
+        return -1;
+    }
+    const Grid& grid = game.board.grid;
+    const PieceData& data = *game.currPiece.data;
+    const PieceData& nextData = *game.nextPiece.data;
+    const int level = game.dynamic.level;
+
+    std::vector<double> shallow(numPlacements);
+    for (int i = 0; i < numPlacements; ++i) {
+        shallow[i] = evaluatePlacement(grid, data, placements[i].placement, weights);
+    }
+    std::vector<int> order(numPlacements);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {return shallow[a] > shallow[b];});
+
+    std::vector<double> deep(numPlacements, 0);
+    std::vector<uint8_t> finished(numPlacements, 0);
+    std::vector<WorkerCounts> counts(pool.size(), WorkerCounts{0, 0});
+    std::vector<std::vector<TimedPlacement>> scratch(pool.size());
+    pool.run(numPlacements, [&](int task, int worker) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return;
+        }
+        int index = order[task];
+        StackRows rows;
+        int lines = placeOnStack(grid, data, placements[index].placement, rows);
+
+        uint64_t key = 0;
+        TableResult cached;
+        if (table) {
+            key = hashPosition(hashRows(rows, grid.height), nextData.index, 0, level, 0);
+            if (table->probe(key, cached)) {
+                deep[index] = scoreLines(lines, weights) + cached.score;
+                finished[index] = 1;
+                ++counts[worker].hits;
+                return;
+            }
+        }
+
+        // The searches only read the occupancy masks, so the colors of the copy are left stale.
+        Grid after = grid;
+        after.rows = rows;
+        std::vector<TimedPlacement>& follow = scratch[worker];
+        if (findTimedPlacements(after, nextData, level, 0, input, follow, deadline) < 0) {
+            return;
+        }
+        TableResult best{-std::numeric_limits<float>::infinity(), Placement{-1, -1, -1}};
+        for (const TimedPlacement& next : follow) {
+            StackRows nextRows;
+            int nextLines = placeOnStack(after, nextData, next.placement, nextRows);
+            float score = scoreFeatures(getFeatures(nextRows, after.height, after.width, nextLines), weights);
+            if (score > best.score) {
+                best = TableResult{score, next.placement};
+            }
+        }
+        if (table) {
+            table->store(key, best);
+        }
+        deep[index] = scoreLines(lines, weights) + best.score;
+        finished[index] = 1;
+        counts[worker].leaves += follow.size();
+    });
+
+    int best = -1;
+    for (int index : order) {
+        if (finished[index] && (best == -1 || deep[index] > deep[best])) {
+            best = index;
+        }
+        stats.searched += finished[index];
+    }
+    for (int worker = 0; worker < pool.size(); ++worker) {
+        stats.leaves += counts[worker].leaves;
+        stats.tableHits += counts[worker].hits;
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (best == -1) ? order[0] : best;
+}
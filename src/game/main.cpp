@@ -1,10 +1,16 @@
 #include <string>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 
 #include "graphics/drawer.hpp"
 #include "game/inputs.hpp"
+#include "game/scripted.hpp"
 #include "game/nes.hpp"
 #include "game/pointclick.hpp"
 
@@ -16,35 +22,67 @@ int main(int argc, char* argv[])
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // Exit status, which is 1 if an input script could not be read
+    int status = 0;
+
     { // This scope holds all of the OpenGL and GLFW operations
 
+        // Extract image/shader parent directory, game type, and level from command line
+        const std::string drawingLocation = argv[1];
+        const std::string mode = (argc > 2) ? argv[2] : std::string("nes");
+        const int startLevel = (argc > 3) ? std::stoi(argv[3]) : 0;
+
+        /*
+         * In spectate mode the fourth argument is the number of games to run side
+         * by side, which are tiled in a roughly square layout. The window is sized
+         * so that the tiles fit on a typical monitor: the tiles are scaled down
+         * until both the width and the height fit, keeping the board proportions.
+         */
+        const int numBoards = (mode == std::string("spectate") && argc > 4) ? std::max(1, std::stoi(argv[4])) : 1;
+        const int tileCols = static_cast<int>(std::ceil(std::sqrt(numBoards)));
+        const int tileRows = (numBoards + tileCols - 1) / tileCols;
+
         // Create the game window and assign to it an OpenGL context loaded by GLEW
-        int windowHeight = 899, windowWidth = 1035; // Set initial dimensions, but will change if manually resized
+        const double tileScale = std::min({1.0, 1800.0/(1035*tileCols), 1000.0/(899*tileRows)});
+        int windowWidth = static_cast<int>(1035*tileCols*tileScale); // Set initial dimensions, but will change if manually resized
+        int windowHeight = static_cast<int>(899*tileRows*tileScale);
         GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Tetris", nullptr, nullptr);
         glfwMakeContextCurrent(window);
         gladLoadGL(); // GLAD loads the appropriate OpenGL functions and variables
 
-        // Extract image/shader parent directory, game type, and level from command line
-        const std::string drawingLocation = argv[1];
-        const std::string mode = (argc > 2) ? argv[2] : std::string("nes");
-        const int startLevel = (argc > 3) ? std::stoi(argv[3]) : 0;
+        /*
+         * In NES mode an input script can be passed in the fourth argument, in 
+         * which case the game is fast-forwarded through the script as quickly as
+         * the CPU allows instead of being paced by the clock. The fifth argument 
+         * sets how many frames to run between each render (defaults to 1), with 
+         * 0 disabling rendering until the script is finished.
+         */
+        const std::string scriptPath = (argc > 4) ? argv[4] : std::string();
+        const long renderEvery = (argc > 5) ? std::stol(argv[5]) : 1;
 
         // Create the keyboard/mouse input handler and the OpenGL drawer
         InputHandler inputs{window};
-        BoardDrawer drawer{drawingLocation};
+        BoardDrawer drawer{drawingLocation, tileRows, tileCols};
 
         // Initialize the specified game mode and begin the frame loop
         if (mode == std::string("nes")) {
 
+            // A script that cannot be read closes the window before any frame is run
+            std::vector<ScriptSegment> segments;
+            if (!scriptPath.empty() && !loadScript(scriptPath, segments)) {
+                status = 1;
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+
             // Create game and assign its display variables to the drawer
             NESTetris game{startLevel};
             game.assignInput(inputs);
             drawer.assignGrid(game.displayGrid);
-            drawer.assignLevel(game.dynamic["level"]);
+            drawer.assignLevel(game.dynamic.level);
             drawer.assignLineCount(game.board.lineCount);
             drawer.assignlineTypeCount(game.board.lineTypeCount);
             drawer.assignNextPiece(game.nextPiece);
-            drawer.assignScore(game.dynamic["score"]);
+            drawer.assignScore(game.dynamic.score);
 
             /* 
              * Set the engine time and the rendering time. Engine time
@@ -60,6 +98,44 @@ int main(int argc, char* argv[])
             const double engSecs = 1 / 60.1; // Recipricol of FPS
             const double rendSecs = 1 / 60.1; // Recipricol of FPS
             
+            if (!scriptPath.empty() && status == 0) {
+                /*
+                 * In fast-forward mode the engine is driven by the script instead 
+                 * of the keyboard, and frames are run back-to-back without waiting 
+                 * on the clock. Since drawing the board is far slower than running 
+                 * a frame, the display is only refreshed every renderEvery frames, 
+                 * and vsync is disabled so that a render does not stall the engine.
+                 * Window events are still polled so the window stays responsive.
+                 */
+                ScriptedInput script{segments, false};
+                game.assignInput(script);
+                glfwSwapInterval(0);
+                long frame = 0;
+                auto start = std::chrono::steady_clock::now();
+                while (!glfwWindowShouldClose(window) && !script.finished()) {
+                    script.nextFrame();
+                    game.runFrame();
+                    ++frame;
+                    if (renderEvery > 0 && frame % renderEvery == 0) {
+                        drawer.drawFrame();
+                        glfwSwapBuffers(window);
+                    }
+                    if (frame % 1024 == 0) {
+                        glfwPollEvents();
+                    }
+                }
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "Ran " << frame << " frames in " << elapsed << " seconds (score " 
+                    << game.dynamic.score << ", lines " << game.board.lineCount << ")" << std::endl;
+
+                // Leave the final position on screen until the window is closed
+                drawer.drawFrame();
+                glfwSwapBuffers(window);
+                while (!glfwWindowShouldClose(window)) {
+                    glfwWaitEvents();
+                }
+            }
+
             // Run the main game loop, with game frames run and drawn seperately
             while (!glfwWindowShouldClose(window)) {
                 double newTime = glfwGetTime();
@@ -79,6 +155,54 @@ int main(int argc, char* argv[])
                 glfwPollEvents();
             }
         }
+        else if (mode == std::string("spectate")) {
+
+            /*
+             * Each game is driven by its own copy of the input script passed in the
+             * fifth argument, or by a script that only soft drops if none is given.
+             * The games are each constructed in place so that they draw their own
+             * piece sequences, and the vectors are reserved up front since the 
+             * drawer and the games keep pointers into them.
+             */
+            std::vector<ScriptSegment> segments{{1, {"down"}}};
+            if (argc > 5 && !loadScript(argv[5], segments)) {
+                status = 1;
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+            std::vector<ScriptedInput> scripts(numBoards, ScriptedInput{segments, true});
+            std::vector<NESTetris> games;
+            games.reserve(numBoards);
+            for (int i = 0; i < numBoards; ++i) {
+                games.emplace_back(startLevel);
+                NESTetris& game = games.back();
+                game.assignInput(scripts[i]);
+                drawer.assignBoard(i, BoardSources{&game.displayGrid, &game.nextPiece, 
+                    &game.board.lineCount, &game.dynamic.score, &game.dynamic.level, &game.board.lineTypeCount});
+            }
+
+            // All of the games run in lockstep, with one shared engine and rendering clock
+            double engTime = 0;
+            double rendTime = 0;
+            const double engSecs = 1 / 60.1;
+            const double rendSecs = 1 / 60.1;
+
+            while (!glfwWindowShouldClose(window)) {
+                double newTime = glfwGetTime();
+                if (newTime - engTime >= engSecs) {
+                    for (int i = 0; i < numBoards; ++i) {
+                        scripts[i].nextFrame();
+                        games[i].runFrame();
+                    }
+                    engTime = newTime;
+                }
+                if (newTime - rendTime >= rendSecs) {
+                    drawer.drawFrame();
+                    glfwSwapBuffers(window);
+                    rendTime = newTime;
+                }
+                glfwPollEvents();
+            }
+        }
         else if (mode == std::string("pointclick")) {
 
             // Create game and assign its display variables to the drawer
@@ -112,5 +236,5 @@ int main(int argc, char* argv[])
         }
     }    
     glfwTerminate();
-    return 0;
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "game/moves.hpp"
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+/*
+ * The functions below enumerate the places where a piece can come to rest
+ * when it is moved from its spawn position using any sequence of left, right,
+ * and down shifts and clockwise or counterclockwise rotations. Rotations are
+ * made in place, as on the NES, so there are no wall kicks. Timing is ignored
+ * (the piece is assumed to have as many moves as it needs before it drops),
+ * so tucks and spins under overhangs are included.
+ *
+ * The search works on whole rows at once. For each center row a fit mask is
+ * built with one 16-bit lane per orientation, where bit col of a lane is set
+ * if the piece fits with its center in that column. Since the center of every
+ * piece is one of its blocks, the center column is always within the grid and
+ * a lane is wide enough for any Grid. The reachable centers of a row are then
+ * found by flooding left and right within the fit mask and rotating between
+ * lanes, starting from the centers that dropped in from the row above. Pieces
+ * cannot move up, so each row only needs to be visited once.
+ */
+
+namespace
+{
+using LaneMask = uint64_t;
+
+constexpr int laneWidth = 16;
+
+// Offset added to rows when indexing the empty masks, since piece cells reach two rows below their center.
+constexpr int rowShift = 2;
+
+// The largest number of resting positions that one search can find.
+constexpr int maxPlacements = 4*Grid::maxHeight*Grid::maxWidth;
+
+using EmptyMasks = std::array<uint16_t, Grid::maxHeight + 2*rowShift>;
+
+constexpr bool offsetsSupported()
+/*
+ * This function checks that the center of every piece in every orientation is
+ * one of its blocks, so that center columns lie within the grid, and that no
+ * block is more than two rows or two columns away from the center.
+ */
+{
+    for (const auto& data : pieceTable) {
+        for (int orient = 0; orient < data.numOrients; ++orient) {
+            bool found = false;
+            for (const auto& rowCol : data.coordOffsets[orient]) {
+                found = found || (rowCol.first == 0 && rowCol.second == 0);
+                if (rowCol.first < -rowShift || rowCol.first > rowShift || rowCol.second < -2 || rowCol.second > 2) {
+                    return false;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(offsetsSupported(), "Piece offsets must fit the masks used by findPlacements");
+
+constexpr LaneMask repeatLanes(uint16_t mask)
+// This function copies a 16-bit mask into all four lanes.
+{
+    return LaneMask{mask} * 0x0001000100010001ull;
+}
+
+uint16_t fitMask(const EmptyMasks& empty, const PieceCoords& offsets, int row)
+/*
+ * This function returns the mask of center columns in which the piece fits with
+ * its center in the passed row. A center fits if the block under each of its
+ * cells is empty, which is found by shifting the empty mask of each cell's row
+ * so that the cell's column lines up with the center's bit.
+ */
+{
+    uint32_t fit = ~uint32_t{0};
+    for (const auto& rowCol : offsets) {
+        // Cells are at most two columns from the center, so pre-shifting by two avoids a branch.
+        uint32_t mask = uint32_t{empty[row + rowCol.first + rowShift]} << 2;
+        fit &= mask >> (rowCol.second + 2);
+    }
+    return fit;
+}
+
+LaneMask fitLanes(const EmptyMasks& empty, const PieceData& data, int row)
+// This function returns the fit masks of every orientation of the piece, one per lane.
+{
+    LaneMask fit = 0;
+    for (int orient = 0; orient < data.numOrients; ++orient) {
+        fit |= LaneMask{fitMask(empty, data.coordOffsets[orient], row)} << (laneWidth*orient);
+    }
+    return fit;
+}
+
+LaneMask floodRow(LaneMask reach, LaneMask fit)
+/*
+ * This function extends the reachable centers of each lane left and right as
+ * far as the fit mask allows. Each step doubles the distance covered, so a lane
+ * is filled in four steps. Bits shifted past the end of a lane are masked off so
+ * that they do not spill into the next orientation.
+ */
+{
+    LaneMask left = reach, right = reach, leftFit = fit, rightFit = fit;
+    for (int step = 1; step < laneWidth; step *= 2) {
+        LaneMask leftKeep = repeatLanes(static_cast<uint16_t>(0xFFFF << step));
+        LaneMask rightKeep = repeatLanes(static_cast<uint16_t>(0xFFFF >> step));
+        left |= leftFit & (left << step) & leftKeep;
+        leftFit &= (leftFit << step) & leftKeep;
+        right |= rightFit & (right >> step) & rightKeep;
+        rightFit &= (rightFit >> step) & rightKeep;
+    }
+    return left | right;
+}
+
+LaneMask rotateLanes(LaneMask reach, int numOrients)
+// This function moves the centers of each orientation to the lanes of the orientations one rotation away.
+{
+    int used = laneWidth*numOrients;
+    LaneMask lanes = (used < 64) ? (LaneMask{1} << used) - 1 : ~LaneMask{0};
+    LaneMask cw = (reach << laneWidth) | (reach >> (used - laneWidth));
+    LaneMask ccw = (reach >> laneWidth) | (reach << (used - laneWidth));
+    return (cw | ccw) & lanes;
+}
+}
+
+void fillFitTable(const Grid& grid, const PieceData& data, FitTable& fits)
+/*
+ * This function fills in the fit masks of every row that a piece can occupy,
+ * for searches that need to test arbitrary positions rather than sweeping down
+ * the rows once.
+ */
+{
+    EmptyMasks empty{};
+    for (int row = 0; row <= spawnRow + rowShift && row < grid.maxHeight; ++row) {
+        empty[row + rowShift] = (row < grid.height) ? ~grid.rows[row] & grid.fullRow : grid.fullRow;
+    }
+    for (int row = 0; row <= spawnRow; ++row) {
+        fits[row] = fitLanes(empty, data, row);
+    }
+}
+
+int findPlacements(const Grid& grid, const PieceData& data, std::vector<Placement>& placements)
+/*
+ * This function fills placements with every distinct resting position of the
+ * piece described by data, starting from the spawn position, and returns how
+ * many were found. Nothing is found if the piece collides as it spawns. The
+ * vector is cleared first but keeps its capacity, so repeated calls with the
+ * same vector do not allocate.
+ */
+{
+    std::array<Placement, maxPlacements> found;
+    int count = 0;
+    int numOrients = data.numOrients;
+    int topRow = spawnRow < grid.maxHeight - rowShift ? spawnRow : grid.maxHeight - rowShift - 1;
+
+    // Rows below the floor are full and rows above the grid are empty.
+    EmptyMasks empty{};
+    int stackTop = -1;
+    for (int row = 0; row <= topRow + rowShift; ++row) {
+        empty[row + rowShift] = (row < grid.height) ? ~grid.rows[row] & grid.fullRow : grid.fullRow;
+        if (row < grid.height && grid.rows[row]) {
+            stackTop = row;
+        }
+    }
+
+    LaneMask fitBelow = fitLanes(empty, data, topRow);
+    LaneMask fit = ~fitBelow;
+    LaneMask reach = (LaneMask{1} << spawnCol) & fitBelow;
+
+    for (int row = topRow; row >= 0; --row) {
+        /*
+         * If the fit masks are the same as in the row above and every center
+         * drops straight down, the centers reached are the same as well and the
+         * flood can be skipped.
+         */
+        LaneMask dropped = reach & fitBelow;
+        bool same = dropped == reach && fitBelow == fit;
+        fit = fitBelow;
+        reach = dropped;
+        if (!reach) {
+            break;
+        }
+
+        // Alternate shifting and rotating until no new centers are reached.
+        while (!same) {
+            reach = floodRow(reach, fit);
+            LaneMask next = reach | (rotateLanes(reach, numOrients) & fit);
+            same = next == reach;
+            reach = next;
+        }
+
+        /*
+         * While every cell of the piece is above the stack, the rows below look
+         * the same as this one, so the piece drops straight to the first row where
+         * a cell could touch the stack.
+         */
+        if (row > stackTop + rowShift + 1) {
+            row = stackTop + rowShift + 2;
+        }
+
+        // Centers that cannot drop any further are resting positions.
+        fitBelow = (row > 0) ? fitLanes(empty, data, row - 1) : 0;
+        LaneMask resting = reach & ~fitBelow;
+        while (resting) {
+            int bit = __builtin_ctzll(resting);
+            resting &= resting - 1;
+            found[count++] = Placement{static_cast<int8_t>(bit / laneWidth),
+                static_cast<int8_t>(bit % laneWidth), static_cast<int8_t>(row)};
+        }
+    }
+    placements.assign(found.begin(), found.begin() + count);
+    return count;
+}
+
+Piece getPlacedPiece(const PieceData& data, const Placement& placement)
+// This function returns a piece of the passed type set to the passed placement.
+{
+    Piece piece{data};
+    piece.setPosition(placement.row, placement.col, placement.orient);
+    return piece;
+}
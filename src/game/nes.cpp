@@ -6,7 +6,15 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <memory>
+#include <array>
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// The pieces of NES Tetris, in the order their generators are given them.
+const std::vector<std::string> pieceNames{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"};
+}
 
 /*
  * The NESTetris class is used to run a simulated version of NES Tetris,
@@ -15,30 +23,30 @@
  * are described below. 
  */
 
-NESTetris::NESTetris(int startLevel) :
+NESTetris::NESTetris(int startLevel, PieceGenerator pieceGen) :
 /*
  * The constructor initializes many of the class members to null
  * values, which will later get actual assignements from the resetGame
  * method called in the body. The firstThreshold member is also assigned
  * in the constructor body, which marks the number of lines needed for 
- * the first level transition.  
+ * the first level transition. The pieces are drawn from the passed
+ * generator, which the other constructors build.
  */
 
 startLevel{startLevel}, // Sets the level to start the game at
 firstThreshold{0}, // Sets the number of lines needed to advance from the first level
-commands{}, // Map holding actions to be performed next frame, described more in resetGame
-dynamic{}, // Map holding variables that change during play, described more in resetGame
-flags{}, // Map holding binary state variables, described more in resetGame
-pieceSeq{}, // Vector of piece names that holds the game's sequence of pieces
+commands{}, // Struct holding actions to be performed next frame, described more in resetGame
+constants{}, // Struct holding level and game constants, described more in setConstants
+dynamic{}, // Struct holding variables that change during play, described more in resetGame
+flags{}, // Struct holding binary state variables, described more in resetGame
 lineScore{0, 0, 0, 0}, // Holds the number of points to award for each type of line clear
-currPiece{nullptr}, // Pointer to the piece currently in play
-nextPiece{nullptr}, // Pointer to the next piece (displayed in window)
-inputPtr{nullptr}, // Pointer to the InputHandler used for player inputs
+currPiece{}, // The piece currently in play
+nextPiece{}, // The next piece (displayed in window)
+inputPtr{nullptr}, // Pointer to the InputSource used for player inputs
 filledRows{}, // Indices of rows filled, used for the line clear animation
 board{20, 10}, // Board used during play
 displayGrid{20, 10}, // The grid used by the drawer and displayed to the player
-// The generator used to create a random piece sequence
-pieceGen{{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"}}
+pieceGen{std::move(pieceGen)} // The generator used to create a random piece sequence
 {
     /*
      * Normally in NES Tetris the level advances every 10 line clears, however the 
@@ -55,6 +63,21 @@ pieceGen{{"lPiece", "jPiece", "sPiece", "zPiece", "iPiece", "tPiece", "sqPiece"}
     resetGame();
 };
 
+NESTetris::NESTetris(int startLevel) :
+// This constructor creates a game with a piece sequence seeded from the system's random device.
+NESTetris(startLevel, PieceGenerator{pieceNames})
+{}
+
+NESTetris::NESTetris(int startLevel, uint32_t seed, RandomMode mode) :
+/*
+ * This constructor creates a game whose piece sequence is fixed by the seed
+ * and random mode, so that the same inputs always produce the same game. The
+ * generator is built from the seed directly, so the system's random device is
+ * not read and the game is reset only once.
+ */
+NESTetris(startLevel, PieceGenerator{pieceNames, seed, mode})
+{}
+
 void NESTetris::resetGame()
 /*
  * This function sets all of the state variables to the values 
@@ -72,14 +95,14 @@ void NESTetris::resetGame()
      * of any specific control scheme. The different commands are explained 
      * in more detail in the setCommands function.  
      */
-    commands["doCCW"] =  false; // Attempt to rotate piece counterclockwise
-    commands["doCW"] = false; // Attempt to rotate piece clockwise
-    commands["doLeft"] = false; // Attempt to move piece left
-    commands["doRight"] =  false; // Attempt to move piece right
-    commands["softDrop"] =  false; // Attempt to drop piece at faster rate
-    commands["leftDAS"] = false; // Attempt to move piece left with DAS
-    commands["rightDAS"] = false; // Attempt to move piece right with DAS
-    commands["reset"] = false; // Attempt to reset game
+    commands.doCCW =  false; // Attempt to rotate piece counterclockwise
+    commands.doCW = false; // Attempt to rotate piece clockwise
+    commands.doLeft = false; // Attempt to move piece left
+    commands.doRight =  false; // Attempt to move piece right
+    commands.softDrop =  false; // Attempt to drop piece at faster rate
+    commands.leftDAS = false; // Attempt to move piece left with DAS
+    commands.rightDAS = false; // Attempt to move piece right with DAS
+    commands.reset = false; // Attempt to reset game
 
 
     /*
@@ -92,7 +115,7 @@ void NESTetris::resetGame()
      * last lowered by gravity. When it equals the "gravity" dynamic variable,
      * the piece is lowered again and the value is reset to zero.  
      */
-    dynamic["dropFrames"] = 0;
+    dynamic.dropFrames = 0;
 
     /*
      * The "gravity" variable determines how many frames need to elapse before
@@ -102,7 +125,7 @@ void NESTetris::resetGame()
      * included among the dynamic variables because a soft drop can temporarily 
      * descreases the value so that the piece falls faster.
      */
-    dynamic["gravity"] = constants["setGravity"];
+    dynamic.gravity = constants.setGravity;
 
     /*
      * dasFrames records how many frames of Delayed Auto Scroll (DAS) have
@@ -116,7 +139,7 @@ void NESTetris::resetGame()
      * zero and it must build up all the way back to dasLimit before the first scroll 
      * happens. After this first scroll the scrolling continues at the intermediate rate.  
      */
-    dynamic["dasFrames"] = 0;
+    dynamic.dasFrames = 0;
 
     /*
      * frozenFrames records how many frames have elapsed while the game is paused after 
@@ -124,7 +147,7 @@ void NESTetris::resetGame()
      * the amount set by entryDelay, the next piece is loaded at the top of the board 
      * and the game is unpaused.
      */
-    dynamic["frozenFrames"] = 0;
+    dynamic.frozenFrames = 0;
 
     /*
      * clearFrames records how many frames have elapsed while the game is paused during 
@@ -135,53 +158,75 @@ void NESTetris::resetGame()
      * is loaded at the top of the board and the game is unpaused. 
      *  
      */
-    dynamic["clearFrames"] = 0;
+    dynamic.clearFrames = 0;
 
     /*
      * totalFrames simply counts how many frames have elapsed since the game began. This
      * quantity is set back to zero when the game is reset.
      */
-    dynamic["totalFrames"] = 0;
+    dynamic.totalFrames = 0;
 
     /*
      * The move variable hold the current move of the game. This value increments whenever 
      * a piece is placed, and can be shifted back and forth as the player reviews old moves. 
      */
-    dynamic["move"] = 0;
+    dynamic.move = 0;
 
     // The score variable holds the player's score.  
-    dynamic["score"] =  0;
+    dynamic.score =  0;
+
+    /*
+     * The entryDelay variable holds the length of the current entry delay, which
+     * is set by setEntryDelay whenever a piece is placed. 
+     */
+    dynamic.entryDelay = 0;
 
     /*
      * The level variable holds the current level. It is initialized to whatever 
      * starting level is specified. 
      */
-    dynamic["level"] = startLevel;
+    dynamic.level = startLevel;
 
     // The flags are binary variables used internally to mark certain conditions.
-    flags["frozen"] = false; // Indicates whether the game is paused for an entry delay 
-    flags["dropDelay"] = true; // Indicates whether the first piece (with added delay) has fallen
+    flags.frozen = false; // Indicates whether the game is paused for an entry delay 
+    flags.dropDelay = true; // Indicates whether the first piece (with added delay) has fallen
+    flags.gameOver = false; // Indicates whether a piece has spawned on top of the stack
 
     filledRows.clear();
     board.reset();
     displayGrid.clear();
-    pieceSeq = pieceGen.getRandomSequence(1000);
+    pieceGen.restartStream(); // Discard the queued pieces of the previous game
     updatePiece(); 
 }
 
 void NESTetris::runFrame()
 /*
- * The runFrame function is called to advance the game by one frame. Depending
- * on the state of the internal variables, a particular type of frame is then
- * chosen to be run. The InputHandler is queried every frame and the commands
- * are set, but they may or may not be used depending on the frame that's run. 
+ * The runFrame function is called to advance the game by one frame. The 
+ * InputSource is queried every frame and the commands are set, but they 
+ * may or may not be used depending on the frame that's run. 
  */
 {
     setCommands();
-    if (commands["reset"]) {
+    runFrame(commands);
+}
+
+void NESTetris::runFrame(const NESCommands& frameCommands)
+/*
+ * This overload advances the game by one frame using the passed commands
+ * instead of querying the InputSource, which lets recorded games be replayed
+ * without one. Depending on the state of the internal variables, a particular
+ * type of frame is then chosen to be run. 
+ */
+{
+    commands = frameCommands;
+    pieceGen.advanceFrame(); // The NES steps its random number generator every frame
+    if (commands.reset) {
         resetGame();
     }
-    if (flags["frozen"] == true) {
+    if (flags.gameOver == true) {
+        // After topping out nothing happens until the game is reset
+    }
+    else if (flags.frozen == true) {
         runFrozenFrame(); // Run during the entry delay
     }
     else {
@@ -192,8 +237,8 @@ void NESTetris::runFrame()
             runActiveFrame(); // Run during regular play
         }
     }
-    resetBool(commands);
-    ++ dynamic["totalFrames"];
+    commands = NESCommands{};
+    ++ dynamic.totalFrames;
 }
 
 void NESTetris::runFrozenFrame()
@@ -205,10 +250,10 @@ void NESTetris::runFrozenFrame()
  * variable, a new piece is placed on the board and play resumes. 
 */
 {
-    ++ dynamic["frozenFrames"];
-    if (dynamic["frozenFrames"] >= dynamic["entryDelay"]) {
-        dynamic["frozenFrames"] = 0;
-        flags["frozen"] = false;
+    ++ dynamic.frozenFrames;
+    if (dynamic.frozenFrames >= dynamic.entryDelay) {
+        dynamic.frozenFrames = 0;
+        flags.frozen = false;
         updatePiece();
         displayPiece();
     }
@@ -225,8 +270,8 @@ void NESTetris::runClearFrame()
  * processed during this type of frame. 
  */
 {
-    ++ dynamic["clearFrames"];
-    switch(dynamic["clearFrames"]) {
+    ++ dynamic.clearFrames;
+    switch(dynamic.clearFrames) {
         case 7:
             for (int row : filledRows) {
                 // Start from the middle and clear from each side 
@@ -259,8 +304,8 @@ void NESTetris::runClearFrame()
             }
             break;
     }
-    if (dynamic["clearFrames"] >= (17 + dynamic["entryDelay"])) {
-        dynamic["clearFrames"] = 0;
+    if (dynamic.clearFrames >= (17 + dynamic.entryDelay)) {
+        dynamic.clearFrames = 0;
         filledRows.clear();
         displayGrid = board.grid;
         updatePiece();
@@ -287,8 +332,8 @@ void NESTetris::runActiveFrame()
      * order to give player a chance to orient themselves. After a fixed amount of
      * time, or if the player does a soft drop, the piece begins to fall.
      */
-    if (flags["dropDelay"] && dynamic["totalFrames"] >= constants["firstDelay"]) {
-        flags["dropDelay"] = false;
+    if (flags.dropDelay && dynamic.totalFrames >= constants.firstDelay) {
+        flags.dropDelay = false;
     }
 
     /*
@@ -301,64 +346,64 @@ void NESTetris::runActiveFrame()
      */
 
     // Counterclockwise rotation:
-    if (commands["doCCW"]) {
-        currPiece->rotate(-1);
-        if (board.grid.collisionCheck(currPiece->coords)) {
-            currPiece->rotate(1);
+    if (commands.doCCW) {
+        currPiece.rotate(-1);
+        if (board.grid.collisionCheck(currPiece.coords)) {
+            currPiece.rotate(1);
         }
     }
 
     // Clockwise rotation:
-    if (commands["doCW"]) {
-        currPiece->rotate(1);
-        if (board.grid.collisionCheck(currPiece->coords)) {
-            currPiece->rotate(-1);
+    if (commands.doCW) {
+        currPiece.rotate(1);
+        if (board.grid.collisionCheck(currPiece.coords)) {
+            currPiece.rotate(-1);
         }
     }
 
     // Left translation:
-    if (commands["doLeft"]) { // Move without DAS
-        dynamic["dasFrames"] = 0;
-        currPiece->translate(0, -1);
-        if (board.grid.collisionCheck(currPiece->coords)) {
-            currPiece->translate(0, 1);
-            dynamic["dasFrames"] = constants["dasLimit"];
+    if (commands.doLeft) { // Move without DAS
+        dynamic.dasFrames = 0;
+        currPiece.translate(0, -1);
+        if (board.grid.collisionCheck(currPiece.coords)) {
+            currPiece.translate(0, 1);
+            dynamic.dasFrames = constants.dasLimit;
         }
     }
-    if (commands["leftDAS"]) { // Move with DAS
-        if (dynamic["dasFrames"] >= constants["dasLimit"]) {
-            dynamic["dasFrames"] = constants["dasFloor"];
-            currPiece->translate(0, -1);
-            if (board.grid.collisionCheck(currPiece->coords)) {
-                currPiece->translate(0, 1);
-                dynamic["dasFrames"] = constants["dasLimit"];
+    if (commands.leftDAS) { // Move with DAS
+        if (dynamic.dasFrames >= constants.dasLimit) {
+            dynamic.dasFrames = constants.dasFloor;
+            currPiece.translate(0, -1);
+            if (board.grid.collisionCheck(currPiece.coords)) {
+                currPiece.translate(0, 1);
+                dynamic.dasFrames = constants.dasLimit;
             }
         }
         else {
-            dynamic["dasFrames"] += 1;
+            dynamic.dasFrames += 1;
         }
     }
     
     // Right translation:
-    if (commands["doRight"]) { // Move without DAS
-        dynamic["dasFrames"] = 0;
-        currPiece->translate(0, 1);
-        if (board.grid.collisionCheck(currPiece->coords)) {
-            currPiece->translate(0, -1);
-            dynamic["dasFrames"] = constants["dasLimit"];
+    if (commands.doRight) { // Move without DAS
+        dynamic.dasFrames = 0;
+        currPiece.translate(0, 1);
+        if (board.grid.collisionCheck(currPiece.coords)) {
+            currPiece.translate(0, -1);
+            dynamic.dasFrames = constants.dasLimit;
         }
     }
-    if (commands["rightDAS"]) { // Move with DAS
-        if (dynamic["dasFrames"] >= constants["dasLimit"]) {
-            dynamic["dasFrames"] = constants["dasFloor"];
-            currPiece->translate(0, 1);
-            if (board.grid.collisionCheck(currPiece->coords)) {
-                currPiece->translate(0, -1);
-                dynamic["dasFrames"] = constants["dasLimit"];
+    if (commands.rightDAS) { // Move with DAS
+        if (dynamic.dasFrames >= constants.dasLimit) {
+            dynamic.dasFrames = constants.dasFloor;
+            currPiece.translate(0, 1);
+            if (board.grid.collisionCheck(currPiece.coords)) {
+                currPiece.translate(0, -1);
+                dynamic.dasFrames = constants.dasLimit;
             }
         }
         else {
-            dynamic["dasFrames"] += 1;
+            dynamic.dasFrames += 1;
         }
     }
 
@@ -369,12 +414,12 @@ void NESTetris::runActiveFrame()
      * the soft drop speed is equal to half the level gravity rounded up, 
      * so after level 18 the soft drop has no effect.
      */
-    if (commands["softDrop"]) {
-        dynamic["gravity"] = (constants["setGravity"] % 2) ? 0.5*(constants["setGravity"] + 1) : 0.5*constants["setGravity"];
-        flags["dropDelay"] = false;
+    if (commands.softDrop) {
+        dynamic.gravity = (constants.setGravity + 1) / 2; // Half the level gravity rounded up
+        flags.dropDelay = false;
     }
     else {
-        dynamic["gravity"] = constants["setGravity"];
+        dynamic.gravity = constants.setGravity;
     }
 
     /*
@@ -387,23 +432,23 @@ void NESTetris::runActiveFrame()
      * Otherwise, an entry delay is started and freeze frames will be run next. 
      */
 
-    if (!flags["dropDelay"] && dynamic["dropFrames"] >= dynamic["gravity"]) {
-        dynamic["dropFrames"] = 0;
-        currPiece->translate(-1, 0);
-        if (board.grid.collisionCheck(currPiece->coords)) {
-            ++ dynamic["move"];
-            currPiece->translate(1, 0);
+    if (!flags.dropDelay && dynamic.dropFrames >= dynamic.gravity) {
+        dynamic.dropFrames = 0;
+        currPiece.translate(-1, 0);
+        if (board.grid.collisionCheck(currPiece.coords)) {
+            ++ dynamic.move;
+            currPiece.translate(1, 0);
             setEntryDelay();
             displayPiece();
             filledRows = displayGrid.getFilledRows();
             if (!filledRows.empty()) {
-                board.placePiece(*currPiece);
+                board.placePiece(currPiece);
                 updateScore();
                 checkLevel();
             }    
             else{
-                board.placePiece(*currPiece);
-                flags["frozen"] = true;
+                board.placePiece(currPiece);
+                flags.frozen = true;
             }
         }
         else {
@@ -411,7 +456,7 @@ void NESTetris::runActiveFrame()
         }
     }    
     else {
-        ++ dynamic["dropFrames"];
+        ++ dynamic.dropFrames;
         displayPiece();
     }
 }
@@ -422,7 +467,7 @@ void NESTetris::displayPiece()
  * the current piece based on its coordinates.
  */
 {
-    displayGrid.fillSet(currPiece->coords, currPiece->data.index);
+    displayGrid.fillSet(currPiece.coords, currPiece.data->index);
 }
 
 void NESTetris::clearPiece()
@@ -431,18 +476,22 @@ void NESTetris::clearPiece()
  * the coordinates of the current piece. 
  */
 {
-    displayGrid.fillSet(currPiece->coords, 0);
+    displayGrid.fillSet(currPiece.coords, 0);
 }
 
 void NESTetris::updatePiece()
 /*
  * This function sets nextPiece as the current piece and draws a random 
- * piece to become the new nextPiece.
+ * piece to become the new nextPiece. The pieces come from the generator's
+ * stream, which draws each piece only when the one before it is taken, 
+ * matching the frame on which the NES chooses its pieces. If the new piece
+ * overlaps the stack as it spawns, the game is over.
  */
 {
-    currPiece = pieceGen.getPiece(pieceSeq[dynamic["move"]]);
-    nextPiece = pieceGen.getPiece(pieceSeq[dynamic["move"] + 1]);
-    currPiece->setPosition(19, 5, 0); // Every piece starts with its center in the same position
+    currPiece = pieceGen.getPiece(pieceGen.next());
+    nextPiece = pieceGen.getPiece(pieceGen.peek(0));
+    currPiece.setPosition(19, 5, 0); // Every piece starts with its center in the same position
+    flags.gameOver = board.grid.collisionCheck(currPiece.coords);
 }
 
 void NESTetris::updateScore()
@@ -451,7 +500,7 @@ void NESTetris::updateScore()
  * Board and the per-line scores dictated by the level. 
  */
 {
-    dynamic["score"] = 
+    dynamic.score = 
         lineScore[0] * board.lineTypeCount[0] +
         lineScore[1] * board.lineTypeCount[1] +
         lineScore[2] * board.lineTypeCount[2] +
@@ -465,23 +514,51 @@ void NESTetris::checkLevel()
  */
 {
     if (board.lineCount >= firstThreshold) {
-        dynamic["level"] = startLevel + (board.lineCount - firstThreshold)/10 + 1;
-        setConstants(dynamic["level"]);
+        dynamic.level = startLevel + (board.lineCount - firstThreshold)/10 + 1;
+        setConstants(dynamic.level);
     }
 }
 
 void NESTetris::setConstants(int level)
 /* 
  * This function sets values that are constant with respect to either a 
- * given level or the game as a whole. They are described individually in
- * more detail below. 
+ * given level or the game as a whole, which are described individually
+ * in getLevelConstants, along with the score awarded for line clears.
  */
 {
+    constants = getLevelConstants(level);
+
+    /*
+     * lineScore holds the number of points associated with each type of line clear. The
+     * scaling is linear and consistent across all levels. 
+     */
+    lineScore = {
+        40*(level + 1),
+        100*(level + 1),
+        300*(level + 1),
+        1200*(level + 1)};
+}
+
+void NESTetris::setEntryDelay()
+// This function sets the entry delay that follows the placement of the current piece.
+{
+    dynamic.entryDelay = getEntryDelay(currPiece.centerRow);
+}
+
+NESConstants getLevelConstants(int level)
+/*
+ * This function returns the timing constants of NES Tetris for the passed
+ * level. It is shared by NESTetris and by code that needs to predict how a
+ * piece will move without running a game, such as the reachability search.
+ */
+{
+    NESConstants constants{};
+
     /*
      * dasLimit determines how high dasFrame has to go to cause the piece
      * to move.   
      */
-    constants["dasLimit"] = 15;
+    constants.dasLimit = 15;
 
     /*
      * dasFloor determines what value dasFrame gets reset while the piece is scrolling.
@@ -489,31 +566,21 @@ void NESTetris::setConstants(int level)
      * first pressed. The speed of scrolling is given by the difference between dasLimit
      * and dasFloor.
      */
-    constants["dasFloor"] = 10;
+    constants.dasFloor = 10;
 
     /*
      * firstDelay is the number of frames that the first piece will wait before dropping,
      * unless the player performs a soft drop
      */
-    constants["firstDelay"] = 96;
+    constants.firstDelay = 96;
 
     /*
      * The height and width of a Tetris grid is 20 x 10 in the vast majority of Tetris
      * versions, including NES Tetris.
      */
-    constants["height"] = 20;
-    constants["width"] = 10;
+    constants.height = 20;
+    constants.width = 10;
 
-    /*
-     * lineScore holds the number of points associated with each type of line clear. The
-     * scaling is linear and consistent across all levels. 
-     */
-    lineScore = {
-        40*(level + 1),
-        100*(level + 1),
-        300*(level + 1),
-        1200*(level + 1)};
-    
     /*
      * The following lines are used to product a value for setGravity, which determines
      * the gravity of a level when the player is not using soft drop. The gravity starts
@@ -522,18 +589,19 @@ void NESTetris::setConstants(int level)
      * three levels, then from level 19 to level 28 the gravity remains at 1 frame. For
      * all levels greater than 28 the gravity is 0, which means the piece falls every frame.   
      */
-    if (level <= 8) constants["setGravity"] = 47 - 5*level;
-    else if (level == 9) constants["setGravity"] = 5;
-    else if (level > 9 && level <= 18) constants["setGravity"] = 4 - (level-10)/3;
-    else if (level > 18 && level <= 28) constants["setGravity"] = 1;
+    if (level <= 8) constants.setGravity = 47 - 5*level;
+    else if (level == 9) constants.setGravity = 5;
+    else if (level > 9 && level <= 18) constants.setGravity = 4 - (level-10)/3;
+    else if (level > 18 && level <= 28) constants.setGravity = 1;
     else if (level > 28) {
-        constants["setGravity"] = 0;
+        constants.setGravity = 0;
     }
+    return constants;
 }
 
-void NESTetris::setEntryDelay()
+int getEntryDelay(int row)
 /*
- * This function determines the duration of the entry delay between piece
+ * This function returns the duration of the entry delay between piece
  * placements, which is determined by how high the piece was placed. Using
  * the center of the piece as reference, the first two rows (indexed from zero) 
  * have an entry delay of 9 frames, then row 2 has a delay of 11, then from row
@@ -541,10 +609,9 @@ void NESTetris::setEntryDelay()
  * have an entry delay of 17. 
  */
 {
-    int row = currPiece->centerRow;
-    if (row <= 1) dynamic["entryDelay"] = 9;
-    else if (row > 1 && row < 14) dynamic["entryDelay"] = 11 + 2*((row - 2)/4);
-    else dynamic["entryDelay"] = 17;
+    if (row <= 1) return 9;
+    else if (row > 1 && row < 14) return 11 + 2*((row - 2)/4);
+    else return 17;
 }
 
 void NESTetris::setCommands()
@@ -561,60 +628,205 @@ void NESTetris::setCommands()
 
     // A key:
     if (keyMap["a"] == "pressed" && keyMap["s"] == "off") {
-        commands["doCCW"] = true;
+        commands.doCCW = true;
     }
 
     // S key:
     if (keyMap["s"] == "pressed" && keyMap["a"] == "off") {
-        commands["doCW"] = true;
+        commands.doCW = true;
     }
 
     // Left key:
     if (keyMap["left"] == "pressed" && keyMap["right"] == "off") {
-        commands["doLeft"] = true;
+        commands.doLeft = true;
     }
     if (keyMap["left"] == "held") {
-        commands["leftDAS"] = true;
+        commands.leftDAS = true;
         }  
 
     // Right key:
     if (keyMap["right"] == "pressed" && keyMap["left"] == "off") {
-        commands["doRight"] = true;
+        commands.doRight = true;
     }
     if (keyMap["right"] == "held") {
-        commands["rightDAS"] = true;
+        commands.rightDAS = true;
     }
 
     // Down key:
     if (keyMap["down"] != "off") {
-        commands["softDrop"] = true;
+        commands.softDrop = true;
     }
     else {
-        commands["softDrop"] = false;
+        commands.softDrop = false;
     }
 
     // Escape key:
     if (keyMap["esc"] == "pressed") {
-        commands["reset"] = true;
+        commands.reset = true;
     }
 }
 
-void NESTetris::assignInput(InputHandler& inputSource)
+void packCells(const Grid& grid, std::array<uint8_t, snapshotCells/2>& cells)
+// This function stores the values of a grid's blocks as 4-bit cells, row by row.
+{
+    cells.fill(0);
+    for (int row = 0, cell = 0; row < grid.height; ++row) {
+        for (int col = 0; col < grid.width && cell < snapshotCells; ++col, ++cell) {
+            cells[cell/2] |= (grid.get(row, col) & 0xF) << (4*(cell % 2));
+        }
+    }
+}
+
+void unpackCells(Grid& grid, const std::array<uint8_t, snapshotCells/2>& cells)
+// This function is the inverse of packCells.
+{
+    grid.clear();
+    for (int row = 0, cell = 0; row < grid.height; ++row) {
+        for (int col = 0; col < grid.width && cell < snapshotCells; ++col, ++cell) {
+            grid.fill(row, col, (cells[cell/2] >> (4*(cell % 2))) & 0xF);
+        }
+    }
+}
+
+NESSnapshot NESTetris::snapshot() const
 /*
- * This function assigns an InputHandler from which the game can 
+ * This function captures the complete state of the game. Restoring the
+ * snapshot later, into this game or any other, continues the game exactly
+ * as if it had never been interrupted. The pieces are stored by index and
+ * position, since their shapes come from the piece table.
+ */
+{
+    NESSnapshot state{};
+    state.startLevel = startLevel;
+    state.firstThreshold = firstThreshold;
+    state.commands = commands;
+    state.flags = flags;
+    state.constants = constants;
+    state.dynamic = dynamic;
+    for (int i = 0; i < 4; ++i) {
+        state.lineScore[i] = lineScore[i];
+        state.lineTypeCount[i] = board.lineTypeCount[i];
+    }
+    state.lineCount = board.lineCount;
+    state.numFilledRows = std::min(static_cast<int>(filledRows.size()), 4);
+    for (int i = 0; i < state.numFilledRows; ++i) {
+        state.filledRows[i] = filledRows[i];
+    }
+    state.currIndex = currPiece.data->index;
+    state.currRow = currPiece.centerRow;
+    state.currCol = currPiece.centerCol;
+    state.currOrient = currPiece.orient;
+    state.nextIndex = nextPiece.data->index;
+    state.generator = pieceGen.getState();
+    packCells(board.grid, state.boardCells);
+    packCells(displayGrid, state.displayCells);
+    return state;
+}
+
+void NESTetris::restore(const NESSnapshot& state)
+// This function returns the game to the state captured by a snapshot.
+{
+    startLevel = state.startLevel;
+    firstThreshold = state.firstThreshold;
+    commands = state.commands;
+    flags = state.flags;
+    constants = state.constants;
+    dynamic = state.dynamic;
+    for (int i = 0; i < 4; ++i) {
+        lineScore[i] = state.lineScore[i];
+        board.lineTypeCount[i] = state.lineTypeCount[i];
+    }
+    board.lineCount = state.lineCount;
+    filledRows.assign(state.filledRows, state.filledRows + std::min<int>(state.numFilledRows, 4));
+    currPiece = pieceGen.getPiece(state.currIndex);
+    currPiece.setPosition(state.currRow, state.currCol, state.currOrient);
+    nextPiece = pieceGen.getPiece(state.nextIndex);
+    pieceGen.setState(state.generator);
+    unpackCells(board.grid, state.boardCells);
+    unpackCells(displayGrid, state.displayCells);
+}
+
+void NESTetris::assignInput(InputSource& inputSource)
+/*
+ * This function assigns an InputSource from which the game can 
  * query inputs.  
  */
 {
     inputPtr = &inputSource;
 }
 
-void resetBool(std::map<const std::string, bool>& bools)
+int* NESTetris::getInt(const std::string& name)
+/*
+ * This function looks up one of the integer game variables (from either the
+ * constants or the dynamic variables) by name, returning a pointer to it or 
+ * nullptr if no variable has that name. This is only meant for the drawer and
+ * for debugging; the engine itself always accesses the struct fields directly. 
+ */
+{
+    auto dynamicItr = dynamicNames.find(name);
+    if (dynamicItr != dynamicNames.end()) {
+        return &(dynamic.*(dynamicItr->second));
+    }
+    auto constantItr = constantNames.find(name);
+    if (constantItr != constantNames.end()) {
+        return &(constants.*(constantItr->second));
+    }
+    return nullptr;
+}
+
+bool* NESTetris::getBool(const std::string& name)
 /*
- * This function sets the Boolean values of a string/bool map to
- * false, which is convenenient when resetting the game commands. 
+ * This function looks up one of the Boolean game variables (from either the 
+ * commands or the flags) by name, in the same manner as getInt. 
  */
 {
-    for (auto& keyValue : bools) {
-        keyValue.second = false;
+    auto commandItr = commandNames.find(name);
+    if (commandItr != commandNames.end()) {
+        return &(commands.*(commandItr->second));
     }
+    auto flagItr = flagNames.find(name);
+    if (flagItr != flagNames.end()) {
+        return &(flags.*(flagItr->second));
+    }
+    return nullptr;
 }
+
+/*
+ * The following maps name each field of the game variable structs, which
+ * allows the variables to be listed or looked up by name.
+ */
+
+const std::map<const std::string, bool NESCommands::*> commandNames{
+    {"doCCW", &NESCommands::doCCW},
+    {"doCW", &NESCommands::doCW},
+    {"doLeft", &NESCommands::doLeft},
+    {"doRight", &NESCommands::doRight},
+    {"softDrop", &NESCommands::softDrop},
+    {"leftDAS", &NESCommands::leftDAS},
+    {"rightDAS", &NESCommands::rightDAS},
+    {"reset", &NESCommands::reset}};
+
+const std::map<const std::string, bool NESFlags::*> flagNames{
+    {"frozen", &NESFlags::frozen},
+    {"dropDelay", &NESFlags::dropDelay},
+    {"gameOver", &NESFlags::gameOver}};
+
+const std::map<const std::string, int NESConstants::*> constantNames{
+    {"dasLimit", &NESConstants::dasLimit},
+    {"dasFloor", &NESConstants::dasFloor},
+    {"firstDelay", &NESConstants::firstDelay},
+    {"height", &NESConstants::height},
+    {"width", &NESConstants::width},
+    {"setGravity", &NESConstants::setGravity}};
+
+const std::map<const std::string, int NESDynamic::*> dynamicNames{
+    {"dropFrames", &NESDynamic::dropFrames},
+    {"gravity", &NESDynamic::gravity},
+    {"dasFrames", &NESDynamic::dasFrames},
+    {"frozenFrames", &NESDynamic::frozenFrames},
+    {"clearFrames", &NESDynamic::clearFrames},
+    {"totalFrames", &NESDynamic::totalFrames},
+    {"move", &NESDynamic::move},
+    {"score", &NESDynamic::score},
+    {"level", &NESDynamic::level},
+    {"entryDelay", &NESDynamic::entryDelay}};
@@ -1,118 +1,37 @@
 #include "game/pieces.hpp"
 
 #include <vector>
+#include <array>
 #include <string>
-#include <map>
-#include <memory>
 #include <random>
-
-/*
- * The PieceData class holds all of the information that characterizes a
- * piece, as described below. One instance is created for each piece type,
- * with all of the different instances of the Piece class containing constant
- * refences to one of them.  
- */
-
-PieceData::PieceData(
-    /* 
-     * The name of the piece, used as an identifier in piece sequences and 
-     * as the key in the master pieceData map allPieces.
-     */
-    std::string name,
-
-    /*
-     * The pieceIndex is how the type of piece is specified on a Grid object,
-     * since the name is impractical to store directly. 
-     */
-    const unsigned int pieceIndex,
-
-    /*
-     * numOrients is simply the number of ways that a piece can be rotated, 
-     * which therefore means it gives the size of all of the vector-of-vector
-     * members described below. 
-     */
-    const int numOrients,
-
-    /*
-     * The coordOffsets are a set of nested vectors describing the full shape of
-     * the piece. The inner-most vector holds a pair of integers that describes 
-     * the location of a piece block relative to the "center". During play the 
-     * "center" is assigned a (row, col) coordinate, and piece blocks are then 
-     * built around it by adding the offset to that coordinate. The number of 
-     * integer pairs determines the number of blocks in the piece, while the 
-     * outermost vector holds a set of integer pairs for each orientation of 
-     * the piece. 
-     */
-    std::vector<std::vector<std::vector<int>>> coordOffsets,
-
-    /*
-     * bottomSurf describes the contour of the bottom of the piece using a 
-     * set of integers that denote how much the higher a given block is 
-     * relative to the block next to it. For example, the square piece has 
-     * a flat bottom and therefore its contour is represented by 0, while the
-     * z-piece has a step shape represented by 1. These contours are used to
-     * determine whether a given piece will fit cleanly onto an existing stack
-     * of pieces. There are a set of integers for each orientation. 
-     * 
-     */
-    std::vector<std::vector<int>> bottomSurf,
-
-    /*
-     * topSurf is the same as bottomSurf except that it describes the contout of 
-     * the top of the piece instead of the bottom. 
-     */
-    std::vector<std::vector<int>> topSurf,
-
-    /*
-     * sideHeight describes how much the edges of a piece alter the contour of the 
-     * surface it is placed on. For example, the square piece is two blocks tall, so
-     * its left side height is 2 (two blocks heigher than the block to its left) and
-     * its right side height it -2 (the surface contour drops by two after the piece).
-     */
-    std::vector<std::vector<int>> sideHeights) :
-name{name}, 
-index{pieceIndex},
-numOrients{numOrients},
-coordOffsets{coordOffsets},
-bottomSurf{bottomSurf},
-topSurf{topSurf},
-sideHeights{sideHeights}
-{}
-
-// Default constructor allows for easy creation of dummy piece
-PieceData::PieceData() :
-name{},
-index{0},
-numOrients{1},
-coordOffsets{{{{0, 0}, {0, 0}, {0, 0}, {0, 0}}}},
-bottomSurf{{}},
-topSurf{{}},
-sideHeights{{1, -1}}
-{}
-
+#include <algorithm>
+#include <cstdint>
 
 /*
  * The Piece class represents a Tetris piece during play. The identity 
  * of the piece is determined by the pieceData that it is assigned when 
  * instantiated. The class members hold to position of the piece at any
- * given instant, and provide function to move and rotate the piece.    
+ * given instant, and provide function to move and rotate the piece. Pieces
+ * are small value types: the coordinates are a fixed-size array and the 
+ * piece data is referenced by pointer, so pieces can be freely copied and
+ * moving them never allocates.
  */
 
 Piece::Piece(const PieceData& data) :
-data{data}, // pieceData reference that defines the piece type
+data{&data}, // pieceData pointer that defines the piece type
 centerRow{0}, // The row assigned as the piece's "center"
 centerCol{0}, // The column assigned as the piece's "center"
 orient{0}, // The orientation of the piece clockwise from entry orientation
-coords{{0, 0}, {0, 0}, {0, 0}, {0, 0}} // Absolute coordinates for piece
+coords{} // Absolute (row, col) coordinates for piece
 {}
 
 // Default constructor allows for easy creation of dummy piece
 Piece::Piece() :
-data{nullPiece},
+data{&pieceTable[0]},
 centerRow{0},
 centerCol{0},
 orient{0},
-coords{{0, 0}, {0, 0}, {0, 0}, {0, 0}}
+coords{}
 {}
 
 void Piece::setPosition(int newCenterRow, int newCenterCol, unsigned int newOrient)
@@ -125,9 +44,10 @@ void Piece::setPosition(int newCenterRow, int newCenterCol, unsigned int newOrie
     centerRow = newCenterRow;
     centerCol = newCenterCol;
     orient = newOrient;
-    for (int i = 0; i < data.coordOffsets[orient].size(); ++i) {
-        coords[i][0] = centerRow + data.coordOffsets[orient][i][0]; // Row
-        coords[i][1] = centerCol + data.coordOffsets[orient][i][1]; // Column
+    const PieceCoords& offsets = data->coordOffsets[orient];
+    for (int i = 0; i < 4; ++i) {
+        coords[i].first = centerRow + offsets[i].first; // Row
+        coords[i].second = centerCol + offsets[i].second; // Column
     }
 }
 
@@ -139,9 +59,9 @@ void Piece::rotate(int turns)
  */
 {
     // Get the new orientation relative to 0, can be postive or negative 
-    int newOrientSigned = (orient + turns) % data.numOrients;
+    int newOrientSigned = (orient + turns) % data->numOrients;
     // If newOrientSigned is negative, loop back around from largest orientation
-    int newOrient = (newOrientSigned >= 0) ? newOrientSigned : data.numOrients + newOrientSigned;
+    int newOrient = (newOrientSigned >= 0) ? newOrientSigned : data->numOrients + newOrientSigned;
     setPosition(centerRow, centerCol, newOrient);
 }
 
@@ -156,26 +76,241 @@ void Piece::translate(int dRow, int dCol)
 /*
  * The PieceGenerator class is used to get new Tetris pieces. It serves as 
  * the interface between the game and the piece data. The class can
- * retrieve pieces by name or generate "random" piece sequences based 
- * on a piece list passed to the constructor. The pieces are all managed 
- * using unique pointers. 
+ * retrieve pieces by index or name, or generate "random" piece sequences 
+ * based on a piece list passed to the constructor. The pieces are returned
+ * by value, and the sequences hold piece indices. The random numbers come
+ * from the "minimal standard" linear congruential engine (the one behind
+ * std::minstd_rand), stepped by hand so that its whole state is a single
+ * integer that can be saved and restored by copying it, and the dice are rolled by rejection sampling rather than with
+ * std::uniform_int_distribution (whose algorithm varies between standard 
+ * libraries), so a given seed produces the same sequence on every platform.
+ * Games read pieces from the generator as a stream, which keeps a fixed
+ * number of upcoming pieces in a small ring buffer and draws a new piece 
+ * each time one is taken, so a game can run forever without storing its 
+ * sequence and starting a new game never allocates.
  */
 
+/*
+ * The NES cartridge chooses pieces using a table of orientation IDs, where
+ * the ID of each piece is the index of its spawn orientation in the game's
+ * own orientation table. The IDs are needed to reproduce the NES procedure
+ * exactly, since the re-roll adds the previous ID to the random number. The
+ * two tables below give the IDs in the cartridge's order and the index in 
+ * our pieceTable of the matching piece.
+ */
+constexpr std::array<uint8_t, 7> nesSpawnTable{0x02, 0x07, 0x08, 0x0A, 0x0B, 0x0E, 0x12}; // T, J, Z, O, S, L, I
+constexpr std::array<uint8_t, 7> nesPieceIndices{6, 2, 4, 7, 3, 1, 5};
+constexpr uint16_t nesDefaultLFSR = 0x8988; // Value of the shift register when the console is powered on
+
+// Parameters of the minimal standard engine: x is replaced by x*48271 mod 2^31 - 1
+constexpr uint32_t engineMultiplier = 48271;
+constexpr uint32_t engineModulus = 2147483647;
+
 PieceGenerator::PieceGenerator(std::vector<std::string> pieceList) :
-pieceList{pieceList}, // Vector of piece names with some size N
-uDistrNp1(0, (pieceList.size() > 0) ? pieceList.size() : 0), // (N + 1)-sided die (0-indexed)
-uDistrN(0, (pieceList.size() > 0) ? pieceList.size() - 1 : 0) // N-sided die (0-indexed) 
+pieceList{}, // Vector of piece indices with some size N
+mode{RandomMode::dice}, // Procedure used to choose pieces
+queue{}, // Ring buffer of upcoming piece indices, filled by restartStream
+queueHead{0}, // Position of the oldest piece in the ring buffer
+lookahead{1}, // Number of upcoming pieces held in the ring buffer
+engine{1}, // State of the psuedo-random engine, which will create the random sequences
+lfsr{nesDefaultLFSR}, // 16-bit shift register used by the NES procedure
+spawnCount{0}, // Number of pieces chosen by the NES procedure
+spawnID{0}, // NES orientation ID of the last piece chosen
+prevChoice{-1} // Initial value can't influence first piece selection
 {
+    for (const auto& pieceName : pieceList) {
+        this->pieceList.push_back(getPieceIndex(pieceName));
+    }
     std::random_device rDev; // System-defined true random-number generator
-    rEng.seed(rDev()); // Seed the psuedo-random engine, which will create the random sequences
+    seed(rDev()); // Without an explicit seed every generator gets a different sequence
+}
+
+PieceGenerator::PieceGenerator(std::vector<std::string> pieceList, uint32_t seed, RandomMode mode) :
+/*
+ * This constructor creates a generator that always produces the same sequence,
+ * which is determined by the seed and the random mode. 
+ */
+pieceList{},
+mode{mode},
+queue{},
+queueHead{0},
+lookahead{1},
+engine{1},
+lfsr{nesDefaultLFSR},
+spawnCount{0},
+spawnID{0},
+prevChoice{-1}
+{
+    for (const auto& pieceName : pieceList) {
+        this->pieceList.push_back(getPieceIndex(pieceName));
+    }
+    this->seed(seed);
+}
+
+void PieceGenerator::seed(uint32_t seed)
+/*
+ * This function restarts the generator from the passed seed. The dice use the
+ * whole seed, while the NES shift register uses its lower 16 bits. A register
+ * of zero would never change, so the power-on value is used in its place.
+ */
+{
+    engine = (seed % engineModulus) ? seed % engineModulus : 1; // Seeded as std::minstd_rand is
+    lfsr = (seed & 0xFFFF) ? static_cast<uint16_t>(seed) : nesDefaultLFSR;
+    spawnCount = 0;
+    spawnID = 0;
+    prevChoice = -1;
+}
+
+void PieceGenerator::setMode(RandomMode mode)
+// Choose the procedure used for subsequent pieces.
+{
+    this->mode = mode;
+}
+
+GeneratorState PieceGenerator::getState() const
+// This function returns the current state of the generator, which is plain data.
+{
+    return GeneratorState{queue, static_cast<uint8_t>(queueHead), static_cast<uint8_t>(lookahead), 
+        engine, lfsr, spawnCount, spawnID, static_cast<int8_t>(prevChoice), mode};
 }
 
-std::vector<std::string> PieceGenerator::getRandomSequence(int length)
+void PieceGenerator::setState(const GeneratorState& state)
+// Restore a state previously returned by getState.
+{
+    queue = state.queue;
+    queueHead = state.queueHead % maxLookahead;
+    lookahead = std::min(std::max(static_cast<int>(state.lookahead), 1), maxLookahead);
+    engine = (state.engine % engineModulus) ? state.engine % engineModulus : 1;
+    lfsr = state.lfsr;
+    spawnCount = state.spawnCount;
+    spawnID = state.spawnID;
+    prevChoice = state.prevChoice;
+    mode = state.mode;
+}
+
+uint32_t PieceGenerator::stepEngine()
 /*
- * This function generates an "NES Tetris random" sequence of pieces of the specified 
- * length using pieces drawn from the generator's piece list, returning a vector of names. 
- * When choosing among N different pieces, NES Tetris does not choose in a unformly random 
- * manner (i.e. not 1/N for each piece), but instead follows the following procedure:
+ * This function advances the random engine and returns its new state, which
+ * is also its output, from 1 to 2^31 - 2. This is the same sequence that
+ * std::minstd_rand produces from the same seed.
+ */
+{
+    engine = static_cast<uint32_t>(static_cast<uint64_t>(engine)*engineMultiplier % engineModulus);
+    return engine;
+}
+
+int PieceGenerator::rollDie(int sides)
+/*
+ * This function rolls a die with the passed number of sides (0-indexed). Engine
+ * outputs at the top of the range that would make some faces more likely than
+ * others are rejected and drawn again.
+ */
+{
+    const uint32_t range = engineModulus - 1;
+    const uint32_t limit = range - range % sides;
+    uint32_t roll;
+    do {
+        roll = stepEngine() - 1;
+    } while (roll >= limit);
+    return roll % sides;
+}
+
+void PieceGenerator::stepLFSR()
+/*
+ * This function advances the NES shift register by one step. The new top bit
+ * is the XOR of bits 1 and 9, and the rest of the register shifts right.
+ */
+{
+    uint16_t bit = ((lfsr >> 9) ^ (lfsr >> 1)) & 1;
+    lfsr = (lfsr >> 1) | (bit << 15);
+}
+
+void PieceGenerator::advanceFrame()
+/*
+ * The NES advances its shift register once every frame, whether or not a piece
+ * is chosen, so the pieces depend on when each one spawns. Games that use the 
+ * NES procedure call this function once per frame to match. It does nothing 
+ * for the dice.
+ */
+{
+    if (mode == RandomMode::nesLFSR) {
+        stepLFSR();
+    }
+}
+
+uint8_t PieceGenerator::nextIndex()
+// This function chooses the next piece of the sequence and returns its index.
+{
+    return (mode == RandomMode::nesLFSR) ? nextNESIndex() : nextDiceIndex();
+}
+
+void PieceGenerator::restartStream()
+/*
+ * This function discards any queued pieces and fills the queue with freshly
+ * drawn ones. It must be called before the first piece is taken from the 
+ * stream, and is called again whenever a game is reset.
+ */
+{
+    queueHead = 0;
+    for (int i = 0; i < lookahead; ++i) {
+        queue[i] = nextIndex();
+    }
+}
+
+void PieceGenerator::setLookahead(int lookahead)
+/*
+ * This function sets how many upcoming pieces the stream keeps queued (between
+ * 1 and maxLookahead) and restarts the stream.
+ */
+{
+    this->lookahead = std::min(std::max(lookahead, 1), maxLookahead);
+    restartStream();
+}
+
+uint8_t PieceGenerator::next()
+/*
+ * This function takes the oldest piece from the stream and draws a new piece
+ * into its slot of the ring buffer, so the queue always holds the same number
+ * of upcoming pieces.
+ */
+{
+    uint8_t index = queue[queueHead];
+    queue[queueHead] = nextIndex();
+    queueHead = (queueHead + 1) % lookahead;
+    return index;
+}
+
+uint8_t PieceGenerator::peek(int ahead) const
+/*
+ * This function returns an upcoming piece without taking it from the stream,
+ * where 0 is the piece that the next call to next() will return. Requests past
+ * the end of the queue return the null piece.
+ */
+{
+    return (ahead >= 0 && ahead < lookahead) ? queue[(queueHead + ahead) % lookahead] : 0;
+}
+
+std::vector<uint8_t> PieceGenerator::getRandomSequence(int length)
+/*
+ * This function generates a sequence of pieces of the specified length, 
+ * continuing from the current state of the generator and returning a vector 
+ * of indices.
+ */
+{
+    std::vector<uint8_t> sequence;
+    sequence.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        sequence.push_back(nextIndex());
+    }
+    return sequence;
+}
+
+uint8_t PieceGenerator::nextDiceIndex()
+/*
+ * This function chooses an "NES Tetris random" piece using pieces drawn from 
+ * the generator's piece list. When choosing among N different pieces, NES Tetris 
+ * does not choose in a unformly random manner (i.e. not 1/N for each piece), 
+ * but instead follows the following procedure:
  *      1) Roll an N-sided and an (N + 1)-sided die, where each value of the N-sided
  *         die corresponds to a piece and the (N + 1)-sided die has an extra "re-roll" 
  *         value on it
@@ -189,144 +324,68 @@ std::vector<std::string> PieceGenerator::getRandomSequence(int length)
  * uniform sampling. 
  */
 {
-    std::vector<std::string> sequence;
-    sequence.reserve(length);
     int N = pieceList.size();
-    int seqChoice = -1; // Initial value can't influence first piece selection
-    for (int i = 0; i < length; ++i) {
-        int indexNp1 = uDistrNp1(rEng); // Roll the (N + 1)-sided die (0-indexed)
-        int indexN = uDistrN(rEng); // Roll the N-sided die (0-indexed)
-        seqChoice = (indexNp1 == N || indexNp1 == seqChoice) ? indexN : indexNp1;
-        sequence.push_back(pieceList[seqChoice]);
+    if (N == 0) {
+        return 0;
     }
-    return sequence;
+    int indexNp1 = rollDie(N + 1); // Roll the (N + 1)-sided die (0-indexed)
+    int indexN = rollDie(N); // Roll the N-sided die (0-indexed)
+    prevChoice = (indexNp1 == N || indexNp1 == prevChoice) ? indexN : indexNp1;
+    return pieceList[prevChoice];
+}
+
+uint8_t PieceGenerator::nextNESIndex()
+/*
+ * This function reproduces the piece selection routine of the NES cartridge,
+ * which always chooses from the seven standard pieces regardless of the piece
+ * list. The high byte of the shift register is added to a running count of
+ * spawned pieces, and the lowest three bits of the sum pick an entry of the 
+ * spawn table. If the sum picks the unused eighth entry or repeats the last
+ * piece, the register is advanced once and the low bits of its high byte are
+ * added to the previous orientation ID, with the result taken modulo 7.
+ */
+{
+    ++spawnCount;
+    unsigned int choice = static_cast<uint8_t>((lfsr >> 8) + spawnCount) & 7;
+    if (choice == 7 || nesSpawnTable[choice] == spawnID) {
+        stepLFSR();
+        choice = (((lfsr >> 8) & 7) + spawnID) % 7;
+    }
+    spawnID = nesSpawnTable[choice];
+    return nesPieceIndices[choice];
 }
 
-std::unique_ptr<Piece> PieceGenerator::getPiece(std::string pieceName)
+Piece PieceGenerator::getPiece(unsigned int index)
 /*
- * This function simply retrieves the piece whose name matches the passed
- * argument, or a null piece if no matching name is found. Note that this
- * piece does not have to be in the generator's piece list, just in the 
- * allPieces map. 
+ * This function simply retrieves the piece with the passed index, or a 
+ * null piece if the index is not in the pieceTable. Note that this piece 
+ * does not have to be in the generator's piece list. 
  */
 {
-    auto pieceItr = allPieces.find(pieceName);
-    std::unique_ptr<Piece> piece{(pieceItr != allPieces.end()) ? new Piece(pieceItr->second) : new Piece()};
-    return piece;
+    return (index < pieceTable.size()) ? Piece(pieceTable[index]) : Piece();
 }
 
-const PieceData nullPiece{}; // Used as a default when a non-existent piece is requested
+Piece PieceGenerator::getPiece(const std::string& pieceName)
+/*
+ * This function retrieves the piece whose name matches the passed
+ * argument, or a null piece if no matching name is found. 
+ */
+{
+    return getPiece(getPieceIndex(pieceName));
+}
 
-// The master piece map, which holds the pieceData instances indexed by name
-const std::map<const std::string, PieceData> allPieces{
-    {"lPiece", {
-        "lPiece",
-        1, // Index
-        4, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {0, 1}, {0, -1}, {-1, -1}},
-        {{0, 0}, {-1, 0}, {1, 0}, {1, -1}},
-        {{0, 0}, {0, -1}, {0, 1}, {1, 1}},
-        {{0, 0}, {1, 0}, {-1, 0}, {-1, 1}}},
-        // Bottom Surface
-        {{1, 0}, {-2}, {0, 0}, {0}},
-        // Top Surface
-        {{0, 0}, {0}, {0, 1}, {-2}},
-        // Side Heights
-        {{2, -1}, {1, -3}, {1, -2}, {3, -1}}
-        }
-    },
-    {"jPiece", {
-        "jPiece",
-        2, // Index
-        4, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {0, -1}, {0, 1}, {-1, 1}},
-        {{0, 0}, {1, 0}, {-1, 0}, {-1, -1}},
-        {{0, 0}, {0, 1}, {0, -1}, {1, -1}},
-        {{0, 0}, {-1, 0}, {1, 0}, {1, 1}}}, 
-        // Bottom Surface
-        {{0, -1}, {0}, {0, 0}, {2}},
-        // Top surface
-        {{0, 0}, {2}, {-1, 0}, {0}},
-        // Side Heights
-        {{1, -2}, {1, -3}, {2, -1}, {3, -1}}
-        }   
-    },
-    {"sPiece", {
-        "sPiece",
-        3, // Index
-        2, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {0, 1}, {-1, -1}, {-1, 0}},
-        {{0, 0}, {1, 0}, {0, 1}, {-1, 1}}},
-        // Bottom Surface
-        {{0, 1}, {-1}},
-        // Top Surface
-        {{1, 0}, {-1}},
-        // Side Heights
-        {{1, -1}, {2, -2}}
-        }
-    },
-    {"zPiece", {
-        "zPiece",
-        4, // Index
-        2, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {0, -1}, {-1, 0}, {-1, 1}},
-        {{0, 0}, {-1, 0}, {0, 1}, {1, 1}}},
-        // Bottom Surface
-        {{-1, 0}, {1}},
-        // Top Surface
-        {{0, -1}, {1}},
-        // Side Heights
-        {{1, -1}, {2, -2}}
-        }
-    },
-    {"iPiece", {
-        "iPiece",
-        5, // Index
-        2, // Number of orientations
-        // Row offsets from center
-        {{{0, 0}, {0, -2}, {0, -1}, {0, 1}},
-        {{0, 0}, {2, 0}, {1, 0}, {-1, 0}}},
-        // Bottom Surface
-        {{0, 0, 0, 0}, {}},
-        // Top Surface
-        {{0, 0, 0, 0}, {}},
-        // Side Heights
-        {{1, -1}, {4, -4}}
-        }
-    },
-    {"tPiece", {
-        "tPiece",
-        6, // Index
-        4, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {-1, 0}, {0, 1}, {0, -1}},
-        {{0, 0}, {0, -1}, {-1, 0}, {1, 0}},
-        {{0, 0}, {1, 0}, {0, -1}, {0, 1}},
-        {{0, 0}, {0, 1}, {1, 0}, {-1, 0}}},
-        // Bottom Surface
-        {{-1, 1}, {-1}, {0, 0}, {1}},
-        // Top Surface
-        {{0, 0}, {1}, {1, -1}, {-1}},
-        // Side Heights
-        {{1, -1}, {1, -3}, {1, -1}, {3, -1}}
-        } 
-    },
-    {"sqPiece", {
-        "sqPiece",
-        7, // Index
-        1, // Number of orientations
-        // Offsets from center
-        {{{0, 0}, {-1, 0}, {-1, -1}, {0, -1}}},
-        // Bottom Surface
-        {{0}},
-        // Top Surface
-        {{0}},
-        // Side Heights
-        {{2, -2}}
+unsigned int getPieceIndex(const std::string& pieceName)
+/*
+ * This function converts a piece name into its index in the pieceTable,
+ * returning 0 (the null piece) if no piece has that name. Names are only
+ * used when reading or writing piece sequences, so this lookup is kept out
+ * of the engine. 
+ */
+{
+    for (const auto& data : pieceTable) {
+        if (data.index && pieceName == data.name) {
+            return data.index;
         }
     }
-};
+    return 0;
+}
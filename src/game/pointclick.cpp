@@ -7,7 +7,6 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <memory>
 
 /*
  * The PointClick class is used to run a version of Tetris in which there is no gravity,
@@ -40,12 +39,12 @@ bottomLeftY{0}, // Holds the y-coordinate of the bottom left corner of the playf
 commands{}, // Map holding actions to be performed next frame, described more in resetGame
 dynamic{}, // Map holding variables that change during play, described more in resetGame
 flags{}, // Map holding binary state variables, described more in resetGame
-record{}, // Vector of Boards that keeps a record of past moves
-pieceSeq{}, // Vector of piece names that holds the game's sequence of pieces
+record{board, 64}, // Tree of the placements made so far, with a Board kept every 64 moves
+pieceSeq{}, // Vector of piece indices that holds the pieces drawn so far, for reviewing moves
 lineScore{0, 0, 0, 0}, // Holds the number of points to award for each type of line clear
-currPiece{nullptr}, // Pointer to the piece currently in play
-nextPiece{nullptr}, // Pointer to the next piece (displayed in window)
-inputPtr{nullptr}, // Pointer to the InputHandler used for player inputs
+currPiece{}, // The piece currently in play
+nextPiece{}, // The next piece (displayed in window)
+inputPtr{nullptr}, // Pointer to the InputSource used for player inputs
 board{20, 10}, // Board used during play
 displayGrid{20, 10}, // Grid used by the Drawer to display the playfield
 // The generator used to create a random piece sequence
@@ -87,6 +86,8 @@ void PointClick::resetGame()
     commands["placePiece"] = false; // Attempt to place piece
     commands["recordBack"] = false; // Attempt to load previous board position
     commands["recordForward"] = false; // Attempt to load next board position
+    commands["variationPrev"] = false; // Attempt to load the previous alternative to the current move
+    commands["variationNext"] = false; // Attempt to load the next alternative to the current move
 
     /*
      * The "dynamic" variables represent game values that regularly change
@@ -131,13 +132,13 @@ void PointClick::resetGame()
     // The flags are binary variables used internally to mark certain conditions.
     flags["inBounds"] = false; // Indicates if the mouse is positioned within the playfield
 
-    pieceSeq = pieceGen.getRandomSequence(1000);
+    pieceSeq.clear(); // Keeps its capacity, so resetting does not allocate
+    pieceGen.restartStream();
     updatePiece();
     setConstants();
     board.reset();
     displayGrid.clear();
-    record.clear();
-    record.push_back(board);
+    record.reset(board);
 }
 
 void PointClick::runFrame()
@@ -156,32 +157,38 @@ void PointClick::runFrame()
     }
     else {
         // Browse move record:
-        if (commands["recordBack"] && dynamic["move"] > 0) {
-            readMove(dynamic["move"] - 1);
+        if (commands["recordBack"] && record.back()) {
+            readMove(record.current);
         }
-        else if (commands["recordForward"] && dynamic["move"] < record.size() - 1) {
-            readMove(dynamic["move"] + 1);
+        else if (commands["recordForward"] && record.forward()) {
+            readMove(record.current);
+        }
+        else if (commands["variationPrev"] && record.switchVariation(-1)) {
+            readMove(record.current);
+        }
+        else if (commands["variationNext"] && record.switchVariation(1)) {
+            readMove(record.current);
         }
         // Move piece:
         if (flags["inBounds"]) {
-            currPiece->setPosition(dynamic["mouseRow"], dynamic["mouseCol"], currPiece->orient);
+            currPiece.setPosition(dynamic["mouseRow"], dynamic["mouseCol"], currPiece.orient);
         }
         // Counterclockwise rotation:
         if (commands["doCCW"]) {
-            currPiece->rotate(-1);
+            currPiece.rotate(-1);
         }
         // Clockwise rotation:
         if (commands["doCW"]) {
-            currPiece->rotate(1);
+            currPiece.rotate(1);
         }
         // Place piece:
         if (commands["placePiece"] && flags["inBounds"]) {
-            if (!board.grid.collisionCheck(currPiece->coords)) {
+            if (!board.grid.collisionCheck(currPiece.coords)) {
                 dynamic["lastPlacedRow"] = dynamic["mouseRow"];
                 dynamic["lastPlacedCol"] = dynamic["mouseCol"];
-                board.placePiece(*currPiece);
+                board.placePiece(currPiece);
                 nextMove();
-                currPiece->setPosition(dynamic["mouseRow"], dynamic["mouseCol"], 0);
+                currPiece.setPosition(dynamic["mouseRow"], dynamic["mouseCol"], 0);
             }
         }
 
@@ -194,7 +201,7 @@ void PointClick::runFrame()
         */
         bool moved = dynamic["mouseRow"] != dynamic["lastPlacedRow"] || dynamic["mouseCol"] != dynamic["lastPlacedCol"];
         if (flags["inBounds"] && moved) {
-            bool collision = board.grid.collisionCheck(currPiece->coords);
+            bool collision = board.grid.collisionCheck(currPiece.coords);
             highlightPiece(collision);
             dynamic["lastPlacedRow"] = -1;
             dynamic["lastPlacedCol"] = -1;
@@ -215,10 +222,10 @@ void PointClick::highlightPiece(bool collision)
  */
 {
     if (!collision) {
-        displayGrid.fillSet(currPiece->coords, 8);
+        displayGrid.fillSet(currPiece.coords, 8);
     }
     else {
-        displayGrid.fillSet(currPiece->coords, 9);
+        displayGrid.fillSet(currPiece.coords, 9);
     }
 }
 
@@ -230,8 +237,8 @@ void PointClick::unHighlightPiece()
  * function is to remove the highlighting caused by highlightPiece.
  */
 {
-    for (auto rowCol : currPiece->coords) {
-        displayGrid.fill(rowCol[0], rowCol[1], board.grid.get(rowCol[0], rowCol[1]));
+    for (auto rowCol : currPiece.coords) {
+        displayGrid.fill(rowCol.first, rowCol.second, board.grid.get(rowCol.first, rowCol.second));
     }
 }
 
@@ -241,53 +248,46 @@ void PointClick::nextMove()
  * the score and selecting the next piece, the function determines whether
  * the player is making a new move based on a previous position (i.e. they 
  * went back to review an older move and decided to make a different move). 
- * If so, the move record gets truncated to the point at which player branched 
- * off, with the new move being the most recent move on record. 
+ * If so, the new move starts a new variation in the move record, and the 
+ * line played before is kept so that the player can switch back to it.
  */
 {
-    if (dynamic["move"] != record.size() - 1) {
-        truncateRecord(dynamic["move"]  + 1);
-    }
     ++dynamic["move"];
-    record.push_back(board);
+    record.push(currPiece, board);
     displayGrid = board.grid;
     updateScore();
     updateLevel();
     updatePiece();
 }
 
-void PointClick::readMove(int move)
+void PointClick::readMove(int node)
 /*
  * This function loads a Board from the move record onto the
  * playfield, allowing the history of the game to be browsed
  * or for the player to change their mind and make a different 
- * move. 
+ * move. The Board is rebuilt from the nearest keyframe, so 
+ * seeking costs the same no matter how large the record is.
  */
 {
-    dynamic["move"] = move;
-    board = record[move];
+    dynamic["move"] = record.getDepth(node);
+    board = record.getBoard(node);
     displayGrid = board.grid;
     updatePiece();
     updateScore();
     updateLevel();
 }
 
-void PointClick::truncateRecord(int moveInclusive)
-/*
- * This function erases moves from the move record based on the
- * passed index, wih that move and more recent moves all being
- * deleted.
- */
-{
-    record.erase(record.begin() + moveInclusive, record.end()); 
-}
-
 void PointClick::updatePiece()
 /*
  * This function selects the current piece and the next piece 
- * from the piece sequence based on the current move. 
+ * from the piece sequence based on the current move. Since moves can
+ * be reviewed, every piece drawn is kept in pieceSeq, which is extended
+ * from the generator's stream only when a new move is reached.
  */
 {
+    while (pieceSeq.size() < static_cast<size_t>(dynamic["move"]) + 2) {
+        pieceSeq.push_back(pieceGen.next());
+    }
     currPiece = pieceGen.getPiece(pieceSeq[dynamic["move"]]);
     nextPiece = pieceGen.getPiece(pieceSeq[dynamic["move"] + 1]);
 }
@@ -414,7 +414,7 @@ void PointClick::setCommands()
  */
 {   
     auto keyStates = inputPtr->getStates({"mouseLeft", "mouseRight", "a", "s", 
-        "z", "x", "esc"});
+        "z", "x", "c", "v", "esc"});
 
     // Left mouse button:
     if (keyStates["mouseLeft"] == "pressed") {
@@ -446,6 +446,16 @@ void PointClick::setCommands()
         commands["recordForward"] = true;
     }
 
+    // C key:
+    if (keyStates["c"] == "pressed") {
+        commands["variationPrev"] = true;
+    }
+
+    // V key:
+    if (keyStates["v"] == "pressed") {
+        commands["variationNext"] = true;
+    }
+
     // Escape key:
     if (keyStates["esc"] == "pressed") {
         commands["reset"] = true;
@@ -474,9 +484,9 @@ std::vector<int> PointClick::getGridPosition(double xpos, double ypos)
     return std::vector<int>{row, col};
 }
 
-void PointClick::assignInput(InputHandler& inputSource)
+void PointClick::assignInput(InputSource& inputSource)
 /*
- * This function assigns an InputHandler from which the game can 
+ * This function assigns an InputSource from which the game can 
  * query inputs.  
  */
 {
@@ -0,0 +1,390 @@
+#include "game/reach.hpp"
+
+#include "game/grid.hpp"
+#include "game/pieces.hpp"
+#include "game/moves.hpp"
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * The functions below find which placements a player can actually reach
+ * before a piece locks, by simulating every frame from spawn the same way
+ * that NESTetris::runActiveFrame does: rotations first, then a direction
+ * press or hold with its DAS counter, then gravity. Every state of the
+ * player's inputs that can occur on a frame is kept once, with the fewest
+ * button presses needed to get there, so the input sequence found for each
+ * placement is one with the fewest presses.
+ *
+ * Gravity does not depend on the inputs (soft drop is not used), so on a
+ * given frame every live state has the same row and drop counter, and a
+ * state only needs its orientation, column, and the inputs it is holding.
+ * The first piece's extra drop delay is not modeled.
+ */
+
+namespace
+{
+// Directions held on the previous frame.
+constexpr uint32_t dirNone = 0, dirLeft = 1, dirRight = 2;
+
+/*
+ * A SearchNode is one state on one frame, with the index of the state on the
+ * previous frame that led to it and the commands used on this frame. The key
+ * packs the state as orient (2 bits), col (4), held direction (2), held A and
+ * B (1 each), DAS counter (4), and then either whether a direction has been
+ * pressed (DAS style) or frames since the last press, up to the tap interval
+ * (hypertap style), in the remaining 18 bits.
+ */
+struct SearchNode
+{
+    uint32_t key;
+    int32_t parent;
+    uint8_t commands;
+    uint8_t presses;
+};
+
+struct SearchState
+{
+    int orient, col, dir, heldA, heldB, das, aux;
+};
+
+uint32_t packState(const SearchState& state)
+// This function packs a state into a SearchNode key.
+{
+    return state.orient | (state.col << 2) | (state.dir << 6) | (state.heldA << 8) |
+        (state.heldB << 9) | (state.das << 10) | (state.aux << 14);
+}
+
+SearchState unpackState(uint32_t key)
+// This function is the inverse of packState.
+{
+    return SearchState{static_cast<int>(key & 3), static_cast<int>((key >> 2) & 15),
+        static_cast<int>((key >> 6) & 3), static_cast<int>((key >> 8) & 1), static_cast<int>((key >> 9) & 1),
+        static_cast<int>((key >> 10) & 15), static_cast<int>(key >> 14)};
+}
+
+bool fits(const FitTable& fitTable, int orient, int row, int col, int width)
+// This function checks whether the piece fits at a position, with rows below the floor never fitting.
+{
+    if (row < 0 || col < 0 || col >= width) {
+        return false;
+    }
+    return (fitTable[row] >> (16*orient + col)) & 1;
+}
+
+/*
+ * A FrameTable finds the node of a state on the frame being built, so that each
+ * state is stored once. It is an open-addressing hash table whose slots are
+ * marked with the frame that filled them, so starting a new frame needs no
+ * clearing. The table holds more slots than there are distinct states.
+ */
+struct FrameTable
+{
+    static constexpr int slotBits = 15;
+    std::vector<int32_t> stamps, indices;
+
+    FrameTable() : stamps(1 << slotBits, -1), indices(1 << slotBits, 0) {}
+
+    int32_t* find(uint32_t key, int32_t frame, const std::vector<SearchNode>& nodes)
+    /*
+     * This function returns the slot holding the node index for a state on the
+     * passed frame, or an empty slot (now marked with the frame) if the state has
+     * not been stored yet, in which case the index is -1.
+     */
+    {
+        uint32_t mask = (1u << slotBits) - 1;
+        uint32_t slot = (key * 2654435761u) >> (32 - slotBits);
+        while (stamps[slot] == frame && nodes[indices[slot]].key != key) {
+            slot = (slot + 1) & mask;
+        }
+        if (stamps[slot] != frame) {
+            stamps[slot] = frame;
+            indices[slot] = -1;
+        }
+        return &indices[slot];
+    }
+};
+
+/*
+ * A FrameRange is the run of nodes holding the states of one frame. When the
+ * states of a frame are exactly those of the frame before, reached in the same
+ * way, the range stands for repeats more frames rather than being stored again.
+ */
+struct FrameRange
+{
+    int32_t begin, end, repeats;
+};
+
+bool sameFrame(const std::vector<SearchNode>& nodes, const FrameRange& before, const FrameRange& last,
+    const FrameRange& next)
+// This function checks whether the states of next repeat those of last, with parents in the same relative positions.
+{
+    if (next.end - next.begin != last.end - last.begin) {
+        return false;
+    }
+    for (int32_t i = 0; i < next.end - next.begin; ++i) {
+        const SearchNode& a = nodes[last.begin + i];
+        const SearchNode& b = nodes[next.begin + i];
+        if (a.key != b.key || a.presses != b.presses || a.commands != b.commands ||
+            a.parent - before.begin != b.parent - last.begin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct LockRecord
+{
+    int presses;
+    int32_t parent;
+    uint8_t commands;
+    int frames;
+};
+}
+
+InputModel dasInput()
+/*
+ * This function returns the DAS input model, in which a direction may be
+ * pressed once per piece and then held. A direction held since before the
+ * piece spawned does not count as the press.
+ */
+{
+    return InputModel{InputStyle::das, 0};
+}
+
+InputModel hypertapInput(double tapsPerSecond)
+/*
+ * This function returns the hypertap input model for a player tapping at the
+ * passed rate. The NES runs at about 60.1 frames per second, and a button has
+ * to be released for at least one frame between presses. Rates below one tap
+ * per second are treated as one tap per second, which gives maxTapInterval.
+ */
+{
+    int interval = static_cast<int>(std::lround(60.0988 / std::max(tapsPerSecond, 1.0)));
+    return InputModel{InputStyle::hypertap, std::min(std::max(interval, 2), maxTapInterval)};
+}
+
+int findTimedPlacements(const Grid& grid, const PieceData& data, int level, int dasFrames,
+    const InputModel& input, std::vector<TimedPlacement>& placements, std::chrono::steady_clock::time_point deadline)
+/*
+ * This function fills placements with every placement of the piece that can
+ * be reached from the spawn position at the passed level, starting with the
+ * passed DAS counter, and returns how many were found. Each placement comes
+ * with the commands to reach it, which can be unpacked and passed to
+ * NESTetris::runFrame one frame at a time. If a deadline is passed, the clock
+ * is checked once per simulated frame, and a search still running at the
+ * deadline is abandoned, leaving placements empty and returning -1.
+ */
+{
+    placements.clear();
+    NESConstants constants = getLevelConstants(level);
+    int numOrients = data.numOrients;
+    int width = grid.width;
+    bool das = input.style == InputStyle::das;
+    bool timed = deadline != std::chrono::steady_clock::time_point::max();
+    int tapInterval = std::min(std::max(input.tapInterval, 1), maxTapInterval);
+
+    FitTable fitTable;
+    fillFitTable(grid, data, fitTable);
+    if (!fits(fitTable, 0, spawnRow, spawnCol, width)) {
+        return 0;
+    }
+
+    // The best way found to lock at each (orient, row, col), by fewest presses.
+    std::array<LockRecord, 4*(spawnRow + 1)*Grid::maxWidth> locks;
+    locks.fill(LockRecord{-1, -1, 0, 0});
+
+    // The packed commands for each rotation (none, CCW, CW) and direction action (none, press, hold).
+    std::array<std::array<uint8_t, 5>, 3> packed{};
+    for (int rotation = 0; rotation < 3; ++rotation) {
+        for (int action = 0; action < 5; ++action) {
+            NESCommands commands{};
+            commands.doCCW = rotation == 1;
+            commands.doCW = rotation == 2;
+            commands.doLeft = action == 1;
+            commands.doRight = action == 2;
+            commands.leftDAS = action == 3;
+            commands.rightDAS = action == 4;
+            packed[rotation][action] = packCommands(commands);
+        }
+    }
+
+    // Each state is stored once per frame, keeping the way to reach it with the fewest presses.
+    std::vector<SearchNode> nodes;
+    nodes.reserve(4096);
+    FrameTable table;
+    int startDas = std::min(std::max(dasFrames, 0), constants.dasLimit);
+    if (das) {
+        for (int dir : {dirNone, dirLeft, dirRight}) {
+            int startCount = (dir == dirNone) ? 0 : startDas;
+            nodes.push_back(SearchNode{packState(SearchState{0, spawnCol, dir, 0, 0, startCount, 0}), -1, 0, 0});
+        }
+    }
+    else {
+        nodes.push_back(SearchNode{packState(SearchState{0, spawnCol, dirNone, 0, 0, 0, tapInterval}), -1, 0, 0});
+    }
+    std::vector<FrameRange> ranges{FrameRange{0, static_cast<int32_t>(nodes.size()), 0}};
+
+    int row = spawnRow, dropFrames = 0;
+    for (int frame = 1; ranges.back().begin != ranges.back().end; ++frame) {
+        if (timed && std::chrono::steady_clock::now() >= deadline) {
+            return -1;
+        }
+        bool drop = dropFrames >= constants.setGravity;
+        FrameRange last = ranges.back();
+        for (int32_t i = last.begin; i < last.end; ++i) {
+            SearchState prev = unpackState(nodes[i].key);
+            int presses = nodes[i].presses;
+            for (int rotation = 0; rotation < 3; ++rotation) {
+                // Rotations are made first, with a button needing to be released before it is pressed again.
+                if ((rotation == 1 && prev.heldA) || (rotation == 2 && prev.heldB)) {
+                    continue;
+                }
+                SearchState state = prev;
+                state.heldA = rotation == 1;
+                state.heldB = rotation == 2;
+                if (rotation != 0) {
+                    int orient = (rotation == 1) ? state.orient + numOrients - 1 : state.orient + 1;
+                    orient %= numOrients;
+                    if (fits(fitTable, orient, row, state.col, width)) {
+                        state.orient = orient;
+                    }
+                }
+
+                for (int dir : {dirNone, dirLeft, dirRight}) {
+                    SearchState next = state;
+                    bool pressed = dir != dirNone && dir != prev.dir;
+                    bool held = dir != dirNone && dir == prev.dir;
+                    int step = (dir == dirLeft) ? -1 : 1;
+                    int action = 0;
+                    next.dir = dir;
+                    if (pressed) {
+                        // A press moves the piece right away and restarts the DAS counter.
+                        if ((das && prev.aux) || (!das && prev.aux < tapInterval)) {
+                            continue;
+                        }
+                        action = dir;
+                        next.das = 0;
+                        if (fits(fitTable, next.orient, row, next.col + step, width)) {
+                            next.col += step;
+                        }
+                        else {
+                            next.das = constants.dasLimit;
+                        }
+                        next.aux = das ? 1 : 0;
+                    }
+                    else if (held) {
+                        // Holding shifts the piece whenever the DAS counter is full.
+                        if (!das) {
+                            continue;
+                        }
+                        action = dir + 2;
+                        if (next.das >= constants.dasLimit) {
+                            next.das = constants.dasFloor;
+                            if (fits(fitTable, next.orient, row, next.col + step, width)) {
+                                next.col += step;
+                            }
+                            else {
+                                next.das = constants.dasLimit;
+                            }
+                        }
+                        else {
+                            next.das += 1;
+                        }
+                    }
+                    if (!das) {
+                        next.aux = std::min(next.aux + 1, tapInterval);
+                    }
+                    if (next.dir == dirNone) {
+                        next.das = 0; // The counter is only read while holding, and a press resets it
+                    }
+
+                    int nextPresses = presses + (rotation != 0) + pressed;
+                    uint8_t commands = packed[rotation][action];
+                    if (drop && !fits(fitTable, next.orient, row - 1, next.col, width)) {
+                        LockRecord& lock = locks[(next.orient*(spawnRow + 1) + row)*Grid::maxWidth + next.col];
+                        if (lock.presses == -1 || nextPresses < lock.presses) {
+                            lock = LockRecord{nextPresses, i, commands, frame};
+                        }
+                        continue;
+                    }
+                    SearchNode node{packState(next), i, commands, static_cast<uint8_t>(std::min(nextPresses, 255))};
+                    int32_t* index = table.find(node.key, frame, nodes);
+                    if (*index == -1) {
+                        *index = nodes.size();
+                        nodes.push_back(node);
+                    }
+                    else if (node.presses < nodes[*index].presses) {
+                        nodes[*index] = node;
+                    }
+                }
+            }
+        }
+
+        /*
+         * Between drops the states usually settle after a few frames, repeating
+         * the frame before exactly. Every frame until the next drop would then be
+         * the same, so they are skipped by marking the last range as repeated.
+         */
+        FrameRange next{last.end, static_cast<int32_t>(nodes.size()), 0};
+        if (!drop && ranges.size() > 1 && sameFrame(nodes, ranges[ranges.size() - 2], last, next)) {
+            nodes.resize(next.begin);
+            int skipped = constants.setGravity - dropFrames;
+            ranges.back().repeats += skipped;
+            frame += skipped - 1;
+            dropFrames = constants.setGravity;
+            continue;
+        }
+        ranges.push_back(next);
+
+        if (drop) {
+            --row;
+            dropFrames = 0;
+        }
+        else {
+            ++dropFrames;
+        }
+    }
+
+    // Each placement's commands are found by following the parents back to spawn.
+    for (int orient = 0; orient < numOrients; ++orient) {
+        for (int lockRow = 0; lockRow <= spawnRow; ++lockRow) {
+            for (int col = 0; col < width; ++col) {
+                const LockRecord& lock = locks[(orient*(spawnRow + 1) + lockRow)*Grid::maxWidth + col];
+                if (lock.presses == -1) {
+                    continue;
+                }
+                TimedPlacement placement{Placement{static_cast<int8_t>(orient), static_cast<int8_t>(col),
+                    static_cast<int8_t>(lockRow)}, lock.frames, lock.presses, std::vector<uint8_t>(lock.frames)};
+                placement.inputs[lock.frames - 1] = lock.commands;
+                int frame = lock.frames - 2;
+                int32_t node = lock.parent;
+                auto range = std::upper_bound(ranges.begin(), ranges.end(), node,
+                    [](int32_t index, const FrameRange& range) {return index < range.begin;}) - 1;
+                for (; range != ranges.begin(); --range) {
+                    for (int repeat = 0; repeat < range->repeats; ++repeat) {
+                        placement.inputs[frame--] = nodes[node].commands;
+                        node = range->begin + (nodes[node].parent - (range - 1)->begin);
+                    }
+                    placement.inputs[frame--] = nodes[node].commands;
+                    node = nodes[node].parent;
+                }
+                placements.push_back(std::move(placement));
+            }
+        }
+    }
+    return placements.size();
+}
+
+int findTimedPlacements(const NESTetris& game, const InputModel& input, std::vector<TimedPlacement>& placements)
+// This function finds the reachable placements of the current piece of a game that has just spawned it.
+{
+    return findTimedPlacements(game.board.grid, *game.currPiece.data, game.dynamic.level,
+        game.dynamic.dasFrames, input, placements);
+}
@@ -0,0 +1,256 @@
+#include "game/replay.hpp"
+
+#include "game/nes.hpp"
+#include "game/pieces.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+/*
+ * A replay stores the commands of every frame of an NES game, which together
+ * with the seed, random mode, and starting level are enough to re-simulate the
+ * game exactly. The file starts with a fixed 16-byte header:
+ *      bytes 0-3   : the characters "NESR"
+ *      byte 4      : format version
+ *      byte 5      : random mode (0 for dice, 1 for the NES shift register)
+ *      byte 6      : starting level
+ *      byte 7      : unused (zero)
+ *      bytes 8-11  : seed, little-endian
+ *      bytes 12-15 : total number of frames, little-endian
+ * The rest of the file is a list of runs, where each run is the byte of command
+ * bits held for the run followed by the number of frames in the run. The length
+ * is written as a varint, seven bits per byte with the high bit marking that
+ * another byte follows, so most runs take two bytes. Since the commands only
+ * change when a key changes, a game takes far less than a byte per frame.
+ */
+
+const char replayMagic[4] = {'N', 'E', 'S', 'R'};
+
+uint8_t packCommands(const NESCommands& commands)
+// This function packs the commands of one frame into a byte, one bit per command.
+{
+    return (commands.doCCW << 0) | (commands.doCW << 1) | (commands.doLeft << 2) |
+        (commands.doRight << 3) | (commands.softDrop << 4) | (commands.leftDAS << 5) |
+        (commands.rightDAS << 6) | (commands.reset << 7);
+}
+
+NESCommands unpackCommands(uint8_t bits)
+// This function is the inverse of packCommands.
+{
+    NESCommands commands{};
+    commands.doCCW = bits & (1 << 0);
+    commands.doCW = bits & (1 << 1);
+    commands.doLeft = bits & (1 << 2);
+    commands.doRight = bits & (1 << 3);
+    commands.softDrop = bits & (1 << 4);
+    commands.leftDAS = bits & (1 << 5);
+    commands.rightDAS = bits & (1 << 6);
+    commands.reset = bits & (1 << 7);
+    return commands;
+}
+
+InputRecorder::InputRecorder(int startLevel, uint32_t seed, RandomMode mode) :
+/*
+ * The InputRecorder class builds a replay one frame at a time. The game
+ * being recorded must have been created with the same starting level, seed,
+ * and random mode, and record must be called with the commands of every frame
+ * in order.
+ */
+header{replayVersion, mode, static_cast<uint8_t>(startLevel), seed, 0}, // Values written to the file header
+runs{}, // Encoded runs of commands that have been completed
+runBits{0}, // Command bits of the run in progress
+runLength{0} // Number of frames in the run in progress
+{}
+
+void InputRecorder::record(const NESCommands& commands)
+/*
+ * This function adds one frame to the recording, extending the current run
+ * if the commands have not changed and otherwise starting a new one.
+ */
+{
+    uint8_t bits = packCommands(commands);
+    if (runLength > 0 && bits != runBits) {
+        endRun();
+    }
+    runBits = bits;
+    ++runLength;
+    ++header.frames;
+}
+
+void InputRecorder::endRun()
+// This function encodes the run in progress.
+{
+    runs.push_back(runBits);
+    uint32_t length = runLength;
+    while (length >= 0x80) {
+        runs.push_back(static_cast<uint8_t>(length) | 0x80);
+        length >>= 7;
+    }
+    runs.push_back(static_cast<uint8_t>(length));
+    runLength = 0;
+}
+
+std::vector<uint8_t> InputRecorder::finish()
+/*
+ * This function returns the complete replay, including the run in progress.
+ * Recording can continue afterwards, in which case the next call returns the
+ * replay of the whole game so far.
+ */
+{
+    if (runLength > 0) {
+        endRun();
+    }
+    std::vector<uint8_t> replay(replayMagic, replayMagic + 4);
+    replay.push_back(header.version);
+    replay.push_back(static_cast<uint8_t>(header.mode));
+    replay.push_back(header.startLevel);
+    replay.push_back(0);
+    for (int i = 0; i < 4; ++i) {
+        replay.push_back(header.seed >> (8*i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        replay.push_back(header.frames >> (8*i));
+    }
+    replay.insert(replay.end(), runs.begin(), runs.end());
+    return replay;
+}
+
+bool InputRecorder::save(const std::string& filePath)
+// This function writes the replay to a file, returning false if it cannot be written.
+{
+    std::vector<uint8_t> replay = finish();
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cout << "Error: Unable to write replay " << filePath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(replay.data()), replay.size());
+    return static_cast<bool>(file);
+}
+
+InputReplayer::InputReplayer(std::vector<uint8_t> data) :
+/*
+ * The InputReplayer class reads the commands of a replay back one frame at a
+ * time. The header is checked when the replayer is created, and a replayer
+ * with an invalid header reports that it has already finished.
+ */
+header{}, // Values read from the file header
+data{data}, // The whole replay
+headerValid{false}, // Whether the replay starts with a header this version understands
+position{replayHeaderSize}, // Position of the next run in the replay
+runBits{0}, // Command bits of the current run
+runLeft{0} // Number of frames left in the current run
+{
+    if (this->data.size() >= replayHeaderSize && std::equal(replayMagic, replayMagic + 4, this->data.begin()) &&
+        this->data[4] == replayVersion && this->data[5] <= static_cast<uint8_t>(RandomMode::nesLFSR)) {
+        header.version = this->data[4];
+        header.mode = static_cast<RandomMode>(this->data[5]);
+        header.startLevel = this->data[6];
+        for (int i = 0; i < 4; ++i) {
+            header.seed |= static_cast<uint32_t>(this->data[8 + i]) << (8*i);
+            header.frames |= static_cast<uint32_t>(this->data[12 + i]) << (8*i);
+        }
+        headerValid = true;
+    }
+}
+
+bool InputReplayer::valid() const
+// This function reports whether the replay has a valid header.
+{
+    return headerValid;
+}
+
+bool InputReplayer::finished() const
+// This function reports whether every frame of the replay has been read.
+{
+    return !headerValid || (runLeft == 0 && position >= data.size());
+}
+
+bool InputReplayer::nextFrame(NESCommands& commands)
+/*
+ * This function sets the passed commands to those of the next frame of the
+ * replay, decoding a new run when the current one is used up. It returns
+ * false, leaving the commands unchanged, once the replay is finished or if
+ * the replay is truncated.
+ */
+{
+    while (runLeft == 0) {
+        if (!readRun()) {
+            return false;
+        }
+    }
+    --runLeft;
+    commands = unpackCommands(runBits);
+    return true;
+}
+
+uint32_t InputReplayer::skipFrames(uint32_t frames)
+/*
+ * This function moves forward through the replay without returning the
+ * commands, which is used to line the replay up with a game restored from
+ * a checkpoint. Whole runs are skipped at once, so this is much faster than
+ * reading the frames one by one. The number of frames skipped is returned,
+ * which is less than requested only if the replay ends first.
+ */
+{
+    uint32_t skipped = 0;
+    while (skipped < frames) {
+        if (runLeft == 0 && !readRun()) {
+            break;
+        }
+        uint32_t step = std::min(runLeft, frames - skipped);
+        runLeft -= step;
+        skipped += step;
+    }
+    return skipped;
+}
+
+bool InputReplayer::readRun()
+/*
+ * This function decodes the next run of the replay, returning false if
+ * there are no runs left or the replay is truncated.
+ */
+{
+    if (!headerValid || position >= data.size()) {
+        return false;
+    }
+    uint8_t bits = data[position++];
+    uint32_t length = 0;
+    int shift = 0;
+    bool more = true;
+    while (more) {
+        if (position >= data.size() || shift > 28) {
+            position = data.size();
+            return false;
+        }
+        uint8_t byte = data[position++];
+        length |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        more = byte & 0x80;
+        shift += 7;
+    }
+    runBits = bits;
+    runLeft = length;
+    return true;
+}
+
+NESTetris InputReplayer::createGame() const
+// This function creates a game with the starting level, seed, and random mode of the replay.
+{
+    return NESTetris{header.startLevel, header.seed, header.mode};
+}
+
+std::vector<uint8_t> loadReplay(const std::string& filePath)
+// This function reads a replay file, returning an empty replay if it cannot be opened.
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cout << "Error: Unable to open replay " << filePath << std::endl;
+        return {};
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
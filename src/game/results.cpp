@@ -0,0 +1,176 @@
+#include "game/results.hpp"
+
+#include "game/nes.hpp"
+
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char resultMagic[8] = {'N', 'E', 'S', 'R', 'S', 'L', 'T', '1'};
+constexpr char csvHeader[] = "game,seed,score,lines,singles,doubles,triples,tetrises,level,frames,end\n";
+constexpr const char* endNames[] = {"topout", "frames", "replay"};
+
+// Start of the line left in a CSV file in place of a result that could not be written.
+constexpr char failedMarker[] = "#unwritten";
+
+// Longest line that formatResult can produce, with every number at its widest.
+constexpr int maxLineLength = 256;
+
+int formatResult(const GameResult& result, char* line)
+// This function writes a result as one line of CSV, returning its length.
+{
+    return std::snprintf(line, maxLineLength, "%llu,%u,%d,%d,%d,%d,%d,%d,%d,%u,%s\n",
+        static_cast<unsigned long long>(result.gameId), result.seed, result.score, result.lines,
+        result.lineTypeCount[0], result.lineTypeCount[1], result.lineTypeCount[2], result.lineTypeCount[3],
+        result.level, result.frames, endNames[static_cast<int>(result.end)]);
+}
+
+bool writeAt(int fd, const void* data, size_t size, uint64_t offset)
+// This function writes a block of data at a position of a file, retrying until it is all written.
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+}
+
+GameResult makeResult(uint64_t gameId, uint32_t seed, const NESTetris& game, uint32_t frames, GameEnd end)
+// This function summarizes a finished game.
+{
+    GameResult result{};
+    result.gameId = gameId;
+    result.seed = seed;
+    result.frames = frames;
+    result.score = game.dynamic.score;
+    result.lines = game.board.lineCount;
+    for (int type = 0; type < 4; ++type) {
+        result.lineTypeCount[type] = game.board.lineTypeCount[type];
+    }
+    result.level = game.dynamic.level;
+    result.end = end;
+    return result;
+}
+
+ResultSink::ResultSink(const std::string& filePath, ResultFormat format) :
+/*
+ * The ResultSink class writes the results of finished games to a file, either
+ * as CSV lines or as GameResult records, and can be written to by any number
+ * of threads at once without a lock. Each write claims the next stretch of the
+ * file by advancing an atomic end offset, and then writes its bytes there with
+ * pwrite, which does not share a file position between threads. Results
+ * appear in the order their writes claimed space, not in game order. The file
+ * is replaced if it exists.
+ */
+fd{-1}, // Descriptor of the output file
+format{format}, // Whether results are written as text or as records
+endOffset{0}, // Position just past the last claimed stretch of the file
+count{0}, // Number of results written
+failed{false} // Whether any write has failed
+{
+    fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cout << "Error: Unable to write results to " << filePath << std::endl;
+        return;
+    }
+    const char* header = (format == ResultFormat::csv) ? csvHeader : resultMagic;
+    size_t headerSize = (format == ResultFormat::csv) ? sizeof(csvHeader) - 1 : sizeof(resultMagic);
+    if (!writeAt(fd, header, headerSize, 0)) {
+        std::cout << "Error: Unable to write results to " << filePath << std::endl;
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    endOffset = headerSize;
+}
+
+ResultSink::~ResultSink()
+{
+    close();
+}
+
+bool ResultSink::isOpen() const
+// This function reports whether results can be written.
+{
+    return fd >= 0;
+}
+
+bool ResultSink::write(const GameResult& result)
+// This function writes one result, returning false (and reporting the first failure) if it could not be written.
+{
+    if (fd < 0) {
+        return false;
+    }
+    char line[maxLineLength];
+    const void* data = &result;
+    size_t size = sizeof(result);
+    if (format == ResultFormat::csv) {
+        size = formatResult(result, line);
+        data = line;
+    }
+    uint64_t offset = endOffset.fetch_add(size, std::memory_order_relaxed);
+    if (!writeAt(fd, data, size, offset)) {
+        // Only the first failure is reported, since a full disk fails every write after it
+        if (!failed.exchange(true, std::memory_order_relaxed)) {
+            std::cout << "Error: Unable to write the result of game " << result.gameId << std::endl;
+        }
+        /*
+         * The space claimed for the result is filled with a marker, if that can
+         * be written, so that the file does not hold a stretch of zeros: a CSV
+         * comment line padded with spaces, or a record of all ones bits, whose
+         * game ID no game has.
+         */
+        char marker[maxLineLength];
+        if (format == ResultFormat::csv) {
+            std::memset(marker, ' ', size);
+            std::memcpy(marker, failedMarker, std::min(size, sizeof(failedMarker) - 1));
+            marker[size - 1] = '\n';
+        }
+        else {
+            std::memset(marker, 0xFF, size);
+        }
+        writeAt(fd, marker, size, offset);
+        return false;
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t ResultSink::size() const
+// This function returns the number of results written so far.
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+bool ResultSink::close()
+/*
+ * This function closes the file, returning false if any write failed. It does
+ * not wait for writes in progress, so every thread writing to the sink has to
+ * have finished (as the workers have once ThreadPool::run returns) before it
+ * is called. A write that failed leaves a marker where its result would have
+ * been, as described in write, unless the marker could not be written either.
+ */
+{
+    if (fd < 0) {
+        return false;
+    }
+    bool success = ::close(fd) == 0 && !failed.load(std::memory_order_relaxed);
+    fd = -1;
+    return success;
+}
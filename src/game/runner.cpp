@@ -0,0 +1,237 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+#include "game/nes.hpp"
+#include "game/replay.hpp"
+#include "game/archive.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/threadpool.hpp"
+#include "game/results.hpp"
+
+/*
+ * The totals of the games played by one worker thread, kept apart from the
+ * other workers' so that no counter is shared, and added up at the end.
+ */
+struct RunTotals
+{
+    long games, topOuts, frames, lines;
+    double score;
+};
+
+std::vector<uint32_t> loadSeeds(const std::string& seedList)
+/*
+ * This function reads the seeds of a run, given either as "first:count" for
+ * a range of consecutive seeds or as a file with one seed per line. An empty
+ * list is returned if the file cannot be read.
+ */
+{
+    std::vector<uint32_t> seeds;
+    size_t colon = seedList.find(':');
+    if (colon != std::string::npos) {
+        uint32_t first = std::stoul(seedList.substr(0, colon));
+        long count = std::stol(seedList.substr(colon + 1));
+        for (long i = 0; i < count; ++i) {
+            seeds.push_back(first + i);
+        }
+        return seeds;
+    }
+    std::ifstream file(seedList);
+    if (!file) {
+        std::cout << "Error: Unable to open seed list " << seedList << std::endl;
+        return seeds;
+    }
+    uint32_t seed;
+    while (file >> seed) {
+        seeds.push_back(seed);
+    }
+    return seeds;
+}
+
+ResultFormat getFormat(const std::string& filePath)
+// This function chooses CSV for a results file ending in ".csv", and binary records otherwise.
+{
+    const std::string extension = ".csv";
+    bool csv = filePath.size() >= extension.size() &&
+        filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+    return csv ? ResultFormat::csv : ResultFormat::binary;
+}
+
+void addResult(RunTotals& totals, const GameResult& result)
+// This function adds a finished game to a worker's totals.
+{
+    ++totals.games;
+    totals.topOuts += result.end == GameEnd::topOut;
+    totals.frames += result.frames;
+    totals.lines += result.lines;
+    totals.score += result.score;
+}
+
+int finishRun(ResultSink& sink, const std::vector<RunTotals>& workerTotals, double elapsed)
+// This function closes the results file and prints the totals of a run.
+{
+    RunTotals totals{0, 0, 0, 0, 0};
+    for (const RunTotals& worker : workerTotals) {
+        totals.games += worker.games;
+        totals.topOuts += worker.topOuts;
+        totals.frames += worker.frames;
+        totals.lines += worker.lines;
+        totals.score += worker.score;
+    }
+    uint64_t written = sink.size();
+    bool success = sink.close();
+    double games = (totals.games > 0) ? totals.games : 1;
+    std::cout << "games " << totals.games << "\n"
+        << "written " << written << "\n"
+        << "topouts " << totals.topOuts << "\n"
+        << "mean score " << totals.score/games << "\n"
+        << "mean lines " << totals.lines/games << "\n"
+        << "frames " << totals.frames << "\n"
+        << "seconds " << elapsed << "\n"
+        << "games per second " << totals.games/elapsed << "\n"
+        << "frames per second " << totals.frames/elapsed << std::endl;
+    if (!success) {
+        std::cout << "Error: Some results could not be written" << std::endl;
+    }
+    return success ? 0 : 1;
+}
+
+int runBots(const std::string& seedList, const std::string& outputPath, int startLevel, long numFrames,
+    int numThreads, const std::string& weightsPath, const std::string& inputStyle)
+/*
+ * This function has the evaluation bot play one game from each seed, with the
+ * games shared out among a pool of worker threads. Every worker keeps its own
+ * game and bot and reuses them from one game to the next, so the workers share
+ * nothing that changes except the results file. A game ends when it tops out
+ * or reaches the frame limit.
+ */
+{
+    std::vector<uint32_t> seeds = loadSeeds(seedList);
+    if (seeds.empty()) {
+        std::cout << "Error: No seeds to play" << std::endl;
+        return 1;
+    }
+    EvalWeights weights = defaultWeights();
+    if (!weightsPath.empty() && weightsPath != "default" && !loadWeights(weightsPath, weights)) {
+        return 1;
+    }
+    InputModel input = (inputStyle.empty() || inputStyle == "das") ? dasInput() : hypertapInput(std::stod(inputStyle));
+    ResultSink sink{outputPath, getFormat(outputPath)};
+    if (!sink.isOpen()) {
+        return 1;
+    }
+
+    struct Worker
+    {
+        NESTetris game;
+        BotPlayer player;
+    };
+    ThreadPool pool{numThreads};
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int worker = 0; worker < pool.size(); ++worker) {
+        workers.push_back(std::make_unique<Worker>(Worker{NESTetris{startLevel, 0, RandomMode::dice}, BotPlayer{weights, input}}));
+    }
+    std::vector<RunTotals> totals(pool.size(), RunTotals{0, 0, 0, 0, 0});
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(seeds.size(), [&](int task, int worker) {
+        NESTetris& game = workers[worker]->game;
+        BotPlayer& player = workers[worker]->player;
+        game.pieceGen.seed(seeds[task]);
+        game.resetGame();
+        player.reset();
+        long frame = 0;
+        for (; frame < numFrames && !game.flags.gameOver; ++frame) {
+            player.setCommands(game);
+            game.runFrame(game.commands);
+        }
+        GameResult result = makeResult(task, seeds[task], game, frame,
+            game.flags.gameOver ? GameEnd::topOut : GameEnd::frameLimit);
+        sink.write(result);
+        addResult(totals[worker], result);
+    });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return finishRun(sink, totals, elapsed);
+}
+
+int runReplays(const std::string& archivePath, const std::string& outputPath, int numThreads)
+/*
+ * This function replays every game of an archive, shared out among a pool of
+ * worker threads as in runBots. The archive is mapped into memory once and
+ * only read, and each worker replays its games into its own engine. A game
+ * ends when it tops out or its replay runs out.
+ */
+{
+    ArchiveReader reader{archivePath};
+    if (!reader.isOpen()) {
+        return 1;
+    }
+    ResultSink sink{outputPath, getFormat(outputPath)};
+    if (!sink.isOpen()) {
+        return 1;
+    }
+    ThreadPool pool{numThreads};
+    std::vector<std::unique_ptr<NESTetris>> engines;
+    for (int worker = 0; worker < pool.size(); ++worker) {
+        engines.push_back(std::make_unique<NESTetris>(0));
+    }
+    std::vector<RunTotals> totals(pool.size(), RunTotals{0, 0, 0, 0, 0});
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(reader.size(), [&](int task, int worker) {
+        const ArchiveEntry& entry = *reader.getEntry(task);
+        InputReplayer replayer = reader.getReplay(entry);
+        if (!replayer.valid()) {
+            std::cout << "Error: Game " << entry.gameId << " has a damaged replay\n";
+            return;
+        }
+        NESTetris& game = *engines[worker];
+        game = replayer.createGame();
+        NESCommands commands{};
+        uint32_t frame = 0;
+        while (!game.flags.gameOver && replayer.nextFrame(commands)) {
+            game.runFrame(commands);
+            ++frame;
+        }
+        GameResult result = makeResult(entry.gameId, replayer.header.seed, game, frame,
+            game.flags.gameOver ? GameEnd::topOut : GameEnd::replayEnd);
+        sink.write(result);
+        addResult(totals[worker], result);
+    });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return finishRun(sink, totals, elapsed);
+}
+
+int main(int argc, char* argv[])
+{
+    /*
+     * The batch runner plays many games in parallel and writes one result per
+     * game (score, lines, line clears of each type, level, frames, and how the
+     * game ended) to a results file, as CSV if its name ends in ".csv" and as
+     * binary GameResult records otherwise. Passing "bot", a seed list (a file
+     * of seeds, or "first:count"), and a results file has the evaluation bot
+     * play a game from each seed, optionally followed by the level, the frame
+     * limit, the number of threads (0 for one per core), a weights file (or
+     * "default"), and an input style ("das" or a tapping rate). Passing
+     * "replay", an archive, and a results file replays every archived game,
+     * optionally followed by the number of threads.
+     */
+    const std::string command = (argc > 1) ? argv[1] : std::string();
+    if (argc > 3 && command == "bot") {
+        return runBots(argv[2], argv[3], (argc > 4) ? std::stoi(argv[4]) : 18,
+            (argc > 5) ? std::stol(argv[5]) : 60*60*60, (argc > 6) ? std::stoi(argv[6]) : 0,
+            (argc > 7) ? argv[7] : std::string(), (argc > 8) ? argv[8] : std::string());
+    }
+    if (argc > 3 && command == "replay") {
+        return runReplays(argv[2], argv[3], (argc > 4) ? std::stoi(argv[4]) : 0);
+    }
+    std::cout << "Usage: tetris_batch bot seeds results [level] [frames] [threads] [weights] [das|Hz]\n"
+        << "       tetris_batch replay archive results [threads]" << std::endl;
+    return 1;
+}
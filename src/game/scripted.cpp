@@ -0,0 +1,138 @@
+#include "game/scripted.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+
+ScriptedInput::ScriptedInput(std::vector<ScriptSegment> script, bool loop) :
+/*
+ * The ScriptedInput class is an InputSource that plays back a fixed script of
+ * held keys instead of reading a keyboard, so that a game can be driven without
+ * a window. The script is a list of segments, each holding a set of keys down
+ * for a number of frames. The driver calls nextFrame once before every game
+ * frame, and the key states are then reported with the same "off", "pressed",
+ * and "held" meanings used by the InputHandler: a key is "pressed" on the first
+ * frame it is down and "held" on every frame after that.
+ */
+script{script}, // Segments of held keys, played in order
+loop{loop}, // Whether to start the script over after the last segment
+segment{0}, // Index of the segment currently being played
+segmentFrame{-1}, // Number of frames already played from the current segment
+prevKeys{}, // Keys that were down on the previous frame
+currKeys{} // Keys that are down on the current frame
+{}
+
+void ScriptedInput::nextFrame()
+/*
+ * This function advances the script by one frame, moving on to the next
+ * segment once the current one has run for its full length. After the last
+ * segment the script either loops or reports no keys down. A looping script
+ * whose segments hold no frames at all ends after one pass through them,
+ * since it would otherwise never find a frame to play.
+ */
+{
+    prevKeys.swap(currKeys);
+    ++segmentFrame;
+    int skipped = 0;
+    while (segment < static_cast<int>(script.size()) && segmentFrame >= script[segment].frames) {
+        segmentFrame = 0;
+        ++segment;
+        if (++skipped > static_cast<int>(script.size())) {
+            segment = script.size();
+            break;
+        }
+        if (segment == static_cast<int>(script.size()) && loop) {
+            segment = 0;
+        }
+    }
+    if (segment < static_cast<int>(script.size())) {
+        currKeys = script[segment].keys;
+    }
+    else {
+        currKeys.clear();
+    }
+}
+
+bool ScriptedInput::finished()
+// This function reports whether a non-looping script has run out of frames.
+{
+    return segment >= static_cast<int>(script.size());
+}
+
+void ScriptedInput::rewind()
+// This function returns the script to its first frame with no keys down.
+{
+    segment = 0;
+    segmentFrame = -1;
+    prevKeys.clear();
+    currKeys.clear();
+}
+
+std::map<const std::string, std::string> ScriptedInput::getStates(std::vector<std::string> keyNames)
+/*
+ * This function returns the states of the requested keys for the current
+ * frame, comparing against the previous frame to tell a fresh press apart
+ * from a held key.
+ */
+{
+    std::map<const std::string, std::string> states;
+    for (auto& keyName : keyNames) {
+        bool down = std::find(currKeys.begin(), currKeys.end(), keyName) != currKeys.end();
+        bool wasDown = std::find(prevKeys.begin(), prevKeys.end(), keyName) != prevKeys.end();
+        states[keyName] = !down ? "off" : (wasDown ? "held" : "pressed");
+    }
+    return states;
+}
+
+std::vector<double> ScriptedInput::getMousePos()
+// Scripts have no mouse, so the cursor is reported as off-screen.
+{
+    return {-1, -1};
+}
+
+std::vector<int> ScriptedInput::getWindowSize()
+// Scripts have no window, so the size of the NES board graphics is reported.
+{
+    return {899, 1035};
+}
+
+bool loadScript(const std::string& filePath, std::vector<ScriptSegment>& script)
+/*
+ * This function reads an input script from a text file into script, returning
+ * false if the file cannot be read. Each line holds a frame count followed by
+ * the names of the keys held down for those frames, such as "12 left down". A
+ * line with only a count holds no keys, and anything after a '#' is ignored.
+ * A script with a count that is not positive is rejected, leaving script empty.
+ */
+{
+    script.clear();
+    std::ifstream scriptFile(filePath);
+    if (!scriptFile.good()) {
+        std::cout << "Error: Unable to open input script " << filePath << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(scriptFile, line)) {
+        std::istringstream lineStream(line.substr(0, line.find('#')));
+        ScriptSegment seg{0, {}};
+        if (!(lineStream >> seg.frames)) {
+            continue; // Blank or comment line
+        }
+        if (seg.frames <= 0) {
+            std::cout << "Error: Input script " << filePath << " has a segment of " << seg.frames
+                << " frames, counts must be positive" << std::endl;
+            script.clear();
+            return false;
+        }
+        std::string key;
+        while (lineStream >> key) {
+            seg.keys.push_back(key);
+        }
+        script.push_back(seg);
+    }
+    return true;
+}
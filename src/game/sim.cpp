@@ -0,0 +1,248 @@
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <memory>
+
+#include "game/nes.hpp"
+#include "game/scripted.hpp"
+#include "game/replay.hpp"
+#include "game/archive.hpp"
+#include "game/bot.hpp"
+#include "game/evaluate.hpp"
+#include "game/reach.hpp"
+#include "game/threadpool.hpp"
+#include "game/transposition.hpp"
+
+void printStats(const NESTetris& game, long numFrames, double elapsed)
+// This function prints the final state of a simulated game.
+{
+    std::cout << "frames " << numFrames << "\n"
+        << "score " << game.dynamic.score << "\n"
+        << "lines " << game.board.lineCount << "\n"
+        << "level " << game.dynamic.level << "\n"
+        << "pieces " << game.dynamic.move << "\n"
+        << "seconds " << elapsed << std::endl;
+}
+
+int replay(const std::string& filePath)
+/*
+ * This function re-simulates a recorded game from its replay file, which
+ * holds everything needed to reproduce the game frame for frame.
+ */
+{
+    InputReplayer replayer{loadReplay(filePath)};
+    if (!replayer.valid()) {
+        std::cout << "Error: " << filePath << " is not a valid replay" << std::endl;
+        return 1;
+    }
+    NESTetris game = replayer.createGame();
+    NESCommands commands{};
+    long frame = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (replayer.nextFrame(commands)) {
+        game.runFrame(commands);
+        ++frame;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "seed " << replayer.header.seed << "\n";
+    printStats(game, frame, elapsed);
+    return 0;
+}
+
+int archive(const std::string& filePath, int numGames, int startLevel, long numFrames, 
+    const std::vector<ScriptSegment>& script)
+/*
+ * This function simulates a number of games from the same script, each with
+ * its own random seed, and appends their replays to an archive. The games are
+ * numbered on from the games already in the archive, and a checkpoint is saved
+ * every minute of play so that any frame can be reached quickly.
+ */
+{
+    ArchiveWriter writer{filePath};
+    if (!writer.isOpen()) {
+        return 1;
+    }
+    const long checkpointInterval = 60*60;
+    std::random_device rDev;
+    for (int i = 0; i < numGames; ++i) {
+        const uint64_t gameId = writer.size();
+        const uint32_t seed = rDev();
+        ScriptedInput inputs{script, true};
+        NESTetris game{startLevel, seed, RandomMode::dice};
+        game.assignInput(inputs);
+        InputRecorder recorder{startLevel, seed, RandomMode::dice};
+        std::vector<ArchiveCheckpoint> checkpoints;
+        for (long frame = 0; frame < numFrames; ++frame) {
+            if (frame > 0 && frame % checkpointInterval == 0) {
+                checkpoints.push_back(makeCheckpoint(frame, game));
+            }
+            inputs.nextFrame();
+            game.setCommands();
+            recorder.record(game.commands);
+            game.runFrame(game.commands);
+        }
+        if (!writer.addGame(gameId, recorder.finish(), game, checkpoints)) {
+            return 1;
+        }
+        std::cout << "game " << gameId << " seed " << seed << " score " << game.dynamic.score 
+            << " lines " << game.board.lineCount << "\n";
+    }
+    return writer.close() ? 0 : 1;
+}
+
+int seek(const std::string& filePath, uint64_t gameId, uint32_t targetFrame)
+/*
+ * This function reproduces the state of an archived game at the passed frame.
+ * The game is restored from the nearest checkpoint when there is one, and is
+ * otherwise replayed from its first frame.
+ */
+{
+    ArchiveReader reader{filePath};
+    const ArchiveEntry* entry = reader.isOpen() ? reader.findGame(gameId) : nullptr;
+    if (!entry) {
+        std::cout << "Error: Game " << gameId << " is not in the archive" << std::endl;
+        return 1;
+    }
+    NESTetris game{0};
+    auto start = std::chrono::steady_clock::now();
+    uint32_t frame = reader.seekGame(*entry, targetFrame, game);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "game " << gameId << " of " << reader.size() << " (final score " << entry->score 
+        << ", lines " << entry->lines << ")\n";
+    printStats(game, frame, elapsed);
+    return 0;
+}
+
+int bot(int startLevel, long numFrames, const std::string& weightsPath, uint32_t seed, 
+    const std::string& inputStyle, const std::string& recordPath, int numThreads, double budget)
+/*
+ * This function lets the evaluation bot play one game, which ends when the
+ * game tops out or the frame limit is reached. The bot shifts pieces with DAS
+ * unless a tapping rate in taps per second is passed as the input style. If a
+ * number of threads is passed, the bot looks at the next piece as well, with
+ * a budget in milliseconds per piece.
+ */
+{
+    EvalWeights weights = defaultWeights();
+    if (!weightsPath.empty() && weightsPath != "default" && !loadWeights(weightsPath, weights)) {
+        return 1;
+    }
+    InputModel input = (inputStyle.empty() || inputStyle == "das") ? dasInput() : hypertapInput(std::stod(inputStyle));
+    BotPlayer player{weights, input};
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<TranspositionTable> table;
+    if (numThreads > 0) {
+        pool = std::make_unique<ThreadPool>(numThreads);
+        table = std::make_unique<TranspositionTable>(20);
+        player.useLookahead(*pool, budget/1000);
+        player.useTable(*table);
+    }
+    NESTetris game{startLevel, seed, RandomMode::dice};
+    InputRecorder recorder{startLevel, seed, RandomMode::dice};
+    long frame = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (; frame < numFrames && !game.flags.gameOver; ++frame) {
+        player.setCommands(game);
+        if (!recordPath.empty() && recordPath != "-") {
+            recorder.record(game.commands);
+        }
+        game.runFrame(game.commands);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "seed " << seed << "\n"
+        << "topout " << game.flags.gameOver << "\n"
+        << "evaluations " << player.evaluations << "\n"
+        << "table hits " << player.tableHits << "\n";
+    printStats(game, frame, elapsed);
+    if (!recordPath.empty() && recordPath != "-" && !recorder.save(recordPath)) {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    /*
+     * Passing "replay" and a replay file re-simulates a recorded game instead. 
+     * Passing "archive" and an archive file, followed by the number of games, 
+     * level, frames, and script, appends simulated games to an archive, and 
+     * passing "seek", an archive file, a game id, and a frame shows that game 
+     * as it was on that frame. Passing "bot" lets the evaluation bot play from
+     * the level in the next argument, optionally followed by the number of
+     * frames, a weights file (or "default"), a seed, an input style ("das" or
+     * a tapping rate), a file to record the game to (or "-"), and the number of
+     * threads and milliseconds per piece for looking at the next piece.
+     */
+    const std::string command = (argc > 1) ? argv[1] : std::string();
+    if (argc > 2 && command == "replay") {
+        return replay(argv[2]);
+    }
+    if (argc > 3 && command == "archive") {
+        std::vector<ScriptSegment> script{{1, {"down"}}};
+        if (argc > 6 && !loadScript(argv[6], script)) {
+            return 1;
+        }
+        return archive(argv[2], std::stoi(argv[3]), (argc > 4) ? std::stoi(argv[4]) : 0, 
+            (argc > 5) ? std::stol(argv[5]) : 5*60*60, script);
+    }
+    if (argc > 4 && command == "seek") {
+        return seek(argv[2], std::stoull(argv[3]), std::stoul(argv[4]));
+    }
+    if (argc > 2 && command == "bot") {
+        return bot(std::stoi(argv[2]), (argc > 3) ? std::stol(argv[3]) : 5*60*60, 
+            (argc > 4) ? argv[4] : std::string(), (argc > 5) ? std::stoul(argv[5]) : std::random_device{}(),
+            (argc > 6) ? argv[6] : std::string(), (argc > 7) ? argv[7] : std::string(),
+            (argc > 8) ? std::stoi(argv[8]) : 0, (argc > 9) ? std::stod(argv[9]) : 100);
+    }
+
+    /*
+     * The simulator runs NES Tetris without a window or OpenGL context. The 
+     * starting level and number of frames to run are given by the first two
+     * arguments (defaulting to level 0 and five minutes of play), and an input
+     * script can optionally be passed in the third argument. Without a script
+     * the piece is simply soft dropped, which stacks pieces in the middle of
+     * the board until the game tops out. The fourth argument seeds the piece
+     * generator so that a run can be repeated exactly, and passing "nes" in the
+     * fifth argument chooses pieces with the NES shift register instead of dice.
+     * If a file is passed in the sixth argument, the game is recorded to it.
+     */
+    const int startLevel = (argc > 1) ? std::stoi(argv[1]) : 0;
+    const long numFrames = (argc > 2) ? std::stol(argv[2]) : 5*60*60;
+    std::vector<ScriptSegment> script{{1, {"down"}}};
+    if (argc > 3 && !loadScript(argv[3], script)) {
+        return 1;
+    }
+
+    const uint32_t seed = (argc > 4) ? std::stoul(argv[4]) : std::random_device{}();
+    const RandomMode mode = (argc > 5 && std::string(argv[5]) == "nes") ? RandomMode::nesLFSR : RandomMode::dice;
+
+    const std::string recordPath = (argc > 6) ? argv[6] : std::string();
+
+    ScriptedInput inputs{script, true};
+    NESTetris game{startLevel, seed, mode};
+    game.assignInput(inputs);
+    InputRecorder recorder{startLevel, seed, mode};
+
+    auto start = std::chrono::steady_clock::now();
+    for (long frame = 0; frame < numFrames; ++frame) {
+        inputs.nextFrame();
+        if (recordPath.empty()) {
+            game.runFrame();
+        }
+        else { // Read the commands first so that they can be recorded
+            game.setCommands();
+            recorder.record(game.commands);
+            game.runFrame(game.commands);
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "seed " << seed << "\n";
+    printStats(game, numFrames, elapsed);
+    if (!recordPath.empty() && !recorder.save(recordPath)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "game/threadpool.hpp"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) :
+/*
+ * The ThreadPool class runs batches of independent tasks on a fixed set of
+ * worker threads, which are started once and then sleep between batches. Each
+ * worker has its own queue of task numbers, and a worker whose queue runs dry
+ * steals from the back of the other queues, so uneven task lengths do not
+ * leave threads idle while work remains. Passing zero or fewer threads uses
+ * one per hardware thread.
+ */
+queues{}, // One queue of task numbers per worker, each with its own lock
+threads{}, // The worker threads
+mutex{}, // Guards job, generation, active, and stopping
+wake{}, // Signaled when a batch is posted or the pool is stopping
+finished{}, // Signaled when a worker runs out of tasks
+job{nullptr}, // The function run for each task of the current batch
+generation{0}, // Number of batches posted so far, so that workers can tell a new batch from an old one
+active{0}, // Number of workers still taking tasks from the current batch
+stopping{false} // Set when the pool is destroyed
+{
+    if (numThreads <= 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int worker = 0; worker < numThreads; ++worker) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int worker = 0; worker < numThreads; ++worker) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+// The destructor wakes the workers so that they exit, and waits for them to do so.
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+int ThreadPool::size() const
+// This function returns the number of worker threads.
+{
+    return threads.size();
+}
+
+void ThreadPool::run(int numTasks, const std::function<void(int task, int worker)>& job)
+/*
+ * This function calls job once for every task number from 0 to numTasks - 1,
+ * spread across the workers, and returns once they have all finished. The
+ * worker number passed along with the task lets a job keep scratch space per
+ * worker instead of sharing it. Tasks are dealt out in turn, so each worker
+ * starts on the lowest-numbered tasks left and callers can put the most
+ * important tasks first.
+ */
+{
+    if (numTasks <= 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int task = 0; task < numTasks; ++task) {
+        TaskQueue& queue = *queues[task % queues.size()];
+        std::lock_guard<std::mutex> queueLock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    this->job = &job;
+    active = queues.size();
+    ++generation;
+    wake.notify_all();
+
+    // A worker only stops being active once its own tasks are done and there are none left to steal.
+    finished.wait(lock, [this] {return active == 0;});
+    this->job = nullptr;
+}
+
+void ThreadPool::workerLoop(int worker)
+/*
+ * This function is run by each worker thread. The worker sleeps until a new
+ * batch is posted, takes tasks until none are left anywhere, and reports back
+ * before sleeping again.
+ */
+{
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(int, int)>* batchJob;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] {return stopping || generation != seen;});
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            batchJob = job;
+        }
+        int task;
+        while (takeTask(worker, task)) {
+            (*batchJob)(task, worker);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active;
+        }
+        finished.notify_all();
+    }
+}
+
+bool ThreadPool::takeTask(int worker, int& task)
+/*
+ * This function takes the next task from the worker's own queue, or failing
+ * that steals the last task from another worker's queue, returning false if
+ * every queue is empty.
+ */
+{
+    int numQueues = queues.size();
+    for (int offset = 0; offset < numQueues; ++offset) {
+        TaskQueue& queue = *queues[(worker + offset) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (offset == 0) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        else {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
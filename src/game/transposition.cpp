@@ -0,0 +1,188 @@
+#include "game/transposition.hpp"
+
+#include "game/grid.hpp"
+#include "game/moves.hpp"
+#include "game/evaluate.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+
+/*
+ * Boards are hashed with Zobrist hashing: every cell of the grid has its own
+ * random 64-bit key, and the hash of a board is the XOR of the keys of its
+ * filled cells. Filling or emptying a cell changes the hash by that cell's key
+ * alone, but since the engine keeps each row as an occupancy mask, the keys are
+ * also combined ahead of time into one table per byte of each row, and a board
+ * is hashed with two lookups per row. The piece types, level, and DAS counter
+ * have keys of their own, which are XORed in to tell apart searches of the
+ * same board that could have different results.
+ */
+
+namespace
+{
+constexpr int levelKeyCount = 30, dasKeyCount = 16;
+
+uint64_t splitMix(uint64_t& state)
+// This function returns the next value of the splitmix64 generator, used to fill the key tables.
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/*
+ * The ZobristKeys struct holds every key. The seed is fixed so that hashes
+ * are the same from one run to the next.
+ */
+struct ZobristKeys
+{
+    std::array<std::array<std::array<uint64_t, 256>, 2>, Grid::maxHeight> rowBytes;
+    std::array<uint64_t, pieceTable.size()> pieces, nextPieces;
+    std::array<uint64_t, levelKeyCount> levels;
+    std::array<uint64_t, dasKeyCount> das;
+
+    ZobristKeys()
+    {
+        uint64_t state = 0x5445545249534E45ull;
+        for (auto& row : rowBytes) {
+            std::array<uint64_t, Grid::maxWidth> cells;
+            for (auto& cell : cells) {
+                cell = splitMix(state);
+            }
+            for (int half = 0; half < 2; ++half) {
+                for (int byte = 0; byte < 256; ++byte) {
+                    uint64_t key = 0;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        key ^= ((byte >> bit) & 1) ? cells[8*half + bit] : 0;
+                    }
+                    row[half][byte] = key;
+                }
+            }
+        }
+        for (auto& key : pieces) key = splitMix(state);
+        for (auto& key : nextPieces) key = splitMix(state);
+        for (auto& key : levels) key = splitMix(state);
+        for (auto& key : das) key = splitMix(state);
+        nextPieces[0] = 0; // No next piece
+    }
+};
+
+const ZobristKeys& getKeys()
+// This function returns the key tables, which are built the first time they are needed.
+{
+    static const ZobristKeys keys;
+    return keys;
+}
+
+// A slot's data word is marked as used so that an empty slot never matches a key.
+constexpr uint64_t usedMark = 1ull << 56;
+
+uint64_t packResult(const TableResult& result)
+// This function packs a result into 64 bits: the score's bits, then the orientation, column, and row.
+{
+    uint32_t scoreBits;
+    std::memcpy(&scoreBits, &result.score, sizeof(scoreBits));
+    return scoreBits | (uint64_t{static_cast<uint8_t>(result.placement.orient)} << 32) |
+        (uint64_t{static_cast<uint8_t>(result.placement.col)} << 40) |
+        (uint64_t{static_cast<uint8_t>(result.placement.row)} << 48) | usedMark;
+}
+
+TableResult unpackResult(uint64_t data)
+// This function is the inverse of packResult.
+{
+    TableResult result;
+    uint32_t scoreBits = static_cast<uint32_t>(data);
+    std::memcpy(&result.score, &scoreBits, sizeof(scoreBits));
+    result.placement = Placement{static_cast<int8_t>(data >> 32), static_cast<int8_t>(data >> 40),
+        static_cast<int8_t>(data >> 48)};
+    return result;
+}
+}
+
+uint64_t hashRows(const StackRows& rows, int height)
+// This function returns the Zobrist hash of the first height rows of a stack.
+{
+    const ZobristKeys& keys = getKeys();
+    uint64_t hash = 0;
+    for (int row = 0; row < height; ++row) {
+        hash ^= keys.rowBytes[row][0][rows[row] & 0xFF] ^ keys.rowBytes[row][1][rows[row] >> 8];
+    }
+    return hash;
+}
+
+uint64_t hashGrid(const Grid& grid)
+// This function returns the Zobrist hash of the filled blocks of a grid, ignoring their colors.
+{
+    return hashRows(grid.rows, grid.height);
+}
+
+uint64_t hashPosition(uint64_t boardHash, int pieceIndex, int nextIndex, int level, int dasFrames)
+/*
+ * This function combines a board's hash with the piece to place, the next
+ * piece (0 if it is not known), the level, and the DAS counter. Levels past
+ * the last one with its own gravity share a key, as do DAS counters past 15.
+ */
+{
+    const ZobristKeys& keys = getKeys();
+    int levelKey = (level < 0) ? 0 : (level >= levelKeyCount) ? levelKeyCount - 1 : level;
+    int dasKey = (dasFrames < 0) ? 0 : (dasFrames >= dasKeyCount) ? dasKeyCount - 1 : dasFrames;
+    return boardHash ^ keys.pieces[pieceIndex] ^ keys.nextPieces[nextIndex] ^ keys.levels[levelKey] ^ keys.das[dasKey];
+}
+
+TranspositionTable::TranspositionTable(int sizeBits) :
+/*
+ * The TranspositionTable class remembers the results of searches by the hash
+ * of the searched position, so a position that comes up again does not have
+ * to be searched again. It has a fixed number of slots (2^sizeBits), and a new
+ * result simply replaces whatever was in its slot. Any number of threads can
+ * probe and store at the same time without locks. Each slot holds the result
+ * and the result XORed with the key, both written with plain atomic stores, so
+ * a slot that one thread reads while another is writing it fails the key check
+ * and is treated as a miss rather than returning a mix of two results.
+ */
+sizeBits{(sizeBits < 1) ? 1 : (sizeBits > 30) ? 30 : sizeBits}, // Base-2 logarithm of the number of slots
+slots{new Slot[size_t{1} << this->sizeBits]} // The slots, indexed by the top bits of the key
+{
+    clear();
+}
+
+bool TranspositionTable::probe(uint64_t key, TableResult& result) const
+// This function looks up the result stored for a key, returning false if there is none.
+{
+    const Slot& slot = slots[key >> (64 - sizeBits)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || !(data & usedMark)) {
+        return false;
+    }
+    result = unpackResult(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const TableResult& result)
+// This function stores the result for a key, replacing the slot's previous contents.
+{
+    Slot& slot = slots[key >> (64 - sizeBits)];
+    uint64_t data = packResult(result);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+// This function empties every slot, which is needed whenever the weights or input model of the searches change.
+{
+    for (size_t i = 0; i < (size_t{1} << sizeBits); ++i) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+int TranspositionTable::size() const
+// This function returns the number of slots.
+{
+    return 1 << sizeBits;
+}
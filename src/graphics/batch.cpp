@@ -0,0 +1,252 @@
+#include "graphics/batch.hpp"
+
+#include "graphics/stb_image.hpp"
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+/*
+ * The TextureAtlas class packs a set of images into a single OpenGL texture,
+ * so that everything on screen can be drawn without switching textures. Images
+ * are added by file path and then packed into the atlas when build is called,
+ * after which the region of the atlas holding each image can be looked up by
+ * the ID returned from addImage. 
+ */
+
+TextureAtlas::TextureAtlas() :
+texture{0}, // Holds the ID of the atlas texture
+atlasWidth{0}, // Pixel width of the atlas
+atlasHeight{0}, // Pixel height of the atlas
+images{}, // RGBA pixel data of each image, held until the atlas is built
+imageSizes{}, // Width and height of each image
+regions{} // Texture coordinates of each image within the atlas
+{}
+
+TextureAtlas::~TextureAtlas()
+// The destructor frees the atlas texture if one was created.
+{
+    if (texture) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+int TextureAtlas::addImage(std::string filePath)
+/*
+ * This function loads an image from disk and queues it to be packed into 
+ * the atlas, returning the ID used to look up its region later. Images are 
+ * loaded upside down to match the OpenGL texture coordinate convention, and 
+ * are always expanded to four channels. 
+ */
+{
+    stbi_set_flip_vertically_on_load(true); // Image will be loaded upside down by default
+    int width = 0, height = 0, nrChannels = 0; // Values will be set by the loader based on image file
+    unsigned char *data = stbi_load(filePath.c_str(), &width, &height, &nrChannels, 4);
+    if (data) {
+        images.emplace_back(data, data + 4*width*height);
+        imageSizes.push_back({width, height});
+    }
+    else {
+        std::cout << "Failed to load texture." << std::endl;
+        images.emplace_back(4, 0); // A single transparent pixel stands in for the image
+        imageSizes.push_back({1, 1});
+    }
+    stbi_image_free(data); // Delete image data
+    return images.size() - 1;
+}
+
+void TextureAtlas::build()
+/*
+ * This function packs the queued images into the atlas using simple shelves:
+ * images are placed left to right along a shelf until the next one no longer
+ * fits in the width of the widest image, at which point a new shelf is started 
+ * above the tallest image of the current shelf. A one pixel gap is left around
+ * each image so that neighbouring images can never be sampled by mistake. The
+ * packed pixels are then uploaded as a single texture and the CPU copies freed.
+ */
+{
+    const int pad = 1;
+    atlasWidth = 0;
+    for (const auto& size : imageSizes) {
+        atlasWidth = std::max(atlasWidth, size[0] + pad);
+    }
+
+    // Assign each image a position in the atlas
+    std::vector<std::vector<int>> positions;
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (const auto& size : imageSizes) {
+        if (shelfX + size[0] + pad > atlasWidth) {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+        positions.push_back({shelfX, shelfY});
+        shelfX += size[0] + pad;
+        shelfHeight = std::max(shelfHeight, size[1] + pad);
+    }
+    atlasHeight = shelfY + shelfHeight;
+
+    // Copy each image into the atlas row by row and record its texture coordinates
+    std::vector<unsigned char> pixels(4*atlasWidth*atlasHeight, 0);
+    regions.clear();
+    for (int i = 0; i < static_cast<int>(images.size()); ++i) {
+        int x = positions[i][0], y = positions[i][1];
+        int width = imageSizes[i][0], height = imageSizes[i][1];
+        for (int row = 0; row < height; ++row) {
+            std::copy_n(&images[i][4*width*row], 4*width, &pixels[4*(atlasWidth*(y + row) + x)]);
+        }
+        regions.push_back({
+            static_cast<float>(x) / atlasWidth, 
+            static_cast<float>(y) / atlasHeight,
+            static_cast<float>(x + width) / atlasWidth,
+            static_cast<float>(y + height) / atlasHeight});
+    }
+    images.clear();
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // GL_NEAREST doesn't require a mipmap
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // GL_NEAREST doesn't require a mipmap
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+}
+
+void TextureAtlas::bind()
+// Convenient member function for binding the atlas texture
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+AtlasRegion TextureAtlas::getRegion(int imageID)
+/*
+ * This function returns the texture coordinates of the corners of an image
+ * within the atlas, or an empty region if the ID is not valid.
+ */
+{
+    return (imageID >= 0 && imageID < static_cast<int>(regions.size())) ? regions[imageID] : AtlasRegion{0, 0, 0, 0};
+}
+
+/*
+ * The SpriteBatch class collects all of the textured squares drawn in a frame
+ * and sends them to OpenGL in a single instanced draw call. Every square is
+ * drawn from the same unit square, whose corners are stored once in a static
+ * buffer, while the pixel rectangle and texture rectangle of each square are 
+ * written to a per-instance buffer that is refilled each frame. The vertex
+ * shader then stretches the unit square to the rectangles of each instance. 
+ */
+
+SpriteBatch::SpriteBatch(int capacity) :
+quadArray{0}, // Holds the ID of the vertex array object
+cornerBuffer{0}, // Holds the ID of the unit square vertex buffer
+cornerIndexBuffer{0}, // Holds the ID of the unit square element buffer
+instanceBuffer{0}, // Holds the ID of the per-square instance buffer
+capacity{capacity}, // Number of squares the instance buffer can currently hold
+instances{} // Instance data queued for the next flush, eight floats per square
+{
+    instances.reserve(8*capacity);
+
+    glGenVertexArrays(1, &quadArray);
+    glBindVertexArray(quadArray);
+
+    // The corners of the unit square, which select between the two edges of each rectangle
+    std::vector<float> corners = {
+        0, 0,
+        1, 0,
+        0, 1,
+        1, 1};
+    glGenBuffers(1, &cornerBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+    glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(float), &corners[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0); // Square corner
+    glEnableVertexAttribArray(0);
+
+    std::vector<unsigned int> sqrIndices = { // Maps four source vertices to the six triangle vertices needed to draw a square
+        0, 1, 2, // Vertices of triangle 1
+        1, 2, 3};  // Vertices of triangle 2
+    glGenBuffers(1, &cornerIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cornerIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sqrIndices.size() * sizeof(unsigned int), &sqrIndices[0], GL_STATIC_DRAW);
+
+    // The instance attributes advance once per square rather than once per vertex
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 8 * capacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); // Pixel rectangle
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float))); // Texture rectangle
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
+}
+
+SpriteBatch::~SpriteBatch()
+/*
+ * The class destructor tells OpenGL to free up all memory associated with the 
+ * buffer objects that were created.
+ */
+{
+    glDeleteBuffers(1, &cornerBuffer);
+    glDeleteBuffers(1, &cornerIndexBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteVertexArrays(1, &quadArray);
+}
+
+void SpriteBatch::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1)
+/*
+ * This function queues a square whose corner (x0, y0) is textured with the 
+ * atlas coordinate (u0, v0) and whose opposite corner (x1, y1) is textured 
+ * with (u1, v1).
+ */
+{
+    instances.insert(instances.end(), {x0, y0, x1, y1, u0, v0, u1, v1});
+}
+
+void SpriteBatch::addQuad(const std::vector<float>& vertices, const AtlasRegion& region, float offsetX, float offsetY)
+/*
+ * This function queues a square given in the four-vertex format used by the
+ * BoardDrawer, where each vertex holds a pixel position and a texture coordinate
+ * in the range [0, 1] of a single image. The first and last vertices are opposite
+ * corners, so they define the whole square, and their texture coordinates are
+ * mapped into the region of the atlas that holds the image. The pixel positions
+ * are shifted by the passed offsets.
+ */
+{
+    float du = region.u1 - region.u0;
+    float dv = region.v1 - region.v0;
+    addQuad(
+        vertices[0] + offsetX, vertices[1] + offsetY, vertices[12] + offsetX, vertices[13] + offsetY,
+        region.u0 + du*vertices[2], region.v0 + dv*vertices[3],
+        region.u0 + du*vertices[14], region.v0 + dv*vertices[15]);
+}
+
+void SpriteBatch::flush()
+/*
+ * This function draws every queued square with one instanced draw call and
+ * then empties the queue. The instance buffer is orphaned before it is filled
+ * so that the driver does not have to wait on the previous frame, and it is 
+ * only reallocated when a frame holds more squares than ever before. The 
+ * shader program and atlas texture must already be bound.
+ */
+{
+    int count = size();
+    if (count) {
+        glBindVertexArray(quadArray);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        capacity = std::max(capacity, count);
+        glBufferData(GL_ARRAY_BUFFER, 8 * capacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(float), &instances[0]);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count);
+    }
+    instances.clear();
+}
+
+int SpriteBatch::size()
+// This function returns the number of squares waiting to be drawn.
+{
+    return instances.size() / 8;
+}
@@ -3,6 +3,7 @@
 #include "graphics/stb_image.hpp"
 #include "graphics/shader.hpp"
 #include "graphics/text.hpp"
+#include "graphics/batch.hpp"
 #include "game/pieces.hpp"
 #include "game/grid.hpp"
 
@@ -22,14 +23,27 @@
  * necessary to display the game graphics. The drawer works independently 
  * from the game engine itself, with their only connection being a set of 
  * poiners that indicate which data the drawer should use when drawing
- * a frame.  
+ * a frame. All of the images are packed into one texture atlas and every
+ * square of a frame is queued in a SpriteBatch, so that the whole frame is
+ * sent to OpenGL in a single draw call. The drawer can also tile several 
+ * boards in one window for spectating many games at once, in which case each
+ * tile has its own set of data pointers but all of them share the same 
+ * shader, atlas, and batch.
  */
 
-BoardDrawer::BoardDrawer(std::string location) : 
+BoardDrawer::BoardDrawer(std::string location, int tileRows, int tileCols) : 
 brdShader( // Initialize the Shader instance that holds the shader program
     (location + std::string("/shaders/v_shader.glsl")).c_str(), 
     (location + std::string("/shaders/f_shader.glsl")).c_str()),
 textDrawer{},
+atlas{},
+batch{512*tileRows*tileCols}, // Sized for full boards plus text, but grows if needed
+tileRows{tileRows}, // Number of rows of boards in the window
+tileCols{tileCols}, // Number of columns of boards in the window
+brdWidth{1035}, // Pixel width of a single game board
+brdHeight{899}, // Pixel height of a single game board
+originX{0}, // Pixel offset of the board currently being drawn
+originY{0}, // Pixel offset of the board currently being drawn
 brdVertices{ // Holds the pixel positions and texture coordinates of the entire game board 
     //   Position         Texture
         0,      0,         0, 1,
@@ -44,93 +58,63 @@ previewPos{ // Holds the pixel positions of the next-piece preview window
     776, 550,   902, 550},
 gridHeight{20}, // Height of the playfield grid
 gridWidth{10}, // Width of the playfield grid  
-blockTextures(5, 0), // Holds the texture IDs for the different types of blocks
+blockImages(5, 0), // Holds the atlas IDs for the different types of blocks
 pieceTexMap{0, 0, 1, 1, 0, 2, 2, 2, 3, 4}, // Maps the piece index to its texture
 blockWidthSpacing{(playFieldPos[2] - playFieldPos[0])/gridWidth}, // Pixel width of each grid block
 blockHeightSpacing{(playFieldPos[5] - playFieldPos[1])/gridHeight}, // Pixel height of each grid block
-nextPieceSource{nullptr}, // Pointer to the next piece
-gridSource{nullptr}, // Pointer to the grid to be displayed
-lineCountSource{nullptr}, // Pointer to the line count data
-scoreSource{nullptr}, // Pointer to the score data
-levelSource{nullptr}, // Pointer to the level data
-lineTypeCountSource{nullptr}, // Pointer to line type data
-sqrArray{0}, // Holds the ID of the vertex array object
-brdTexture{0}, // Holds the ID of the NES board texture
-fontTexture{0}, // Holds the ID of the font bitmap texture
-sqrBuffer{0}, // Holds the ID of the vertex buffer object
-sqrIndexBuffer{0} // Holds the ID of the element buffer object
+boards(tileRows*tileCols, BoardSources{}), // Pointers to the data displayed on each tile, null until assigned
+brdImage{0}, // Holds the atlas ID of the NES board image
+fontImage{0} // Holds the atlas ID of the font bitmap image
 {   
 
-    // Tell the shader program how big the game board is
-    brdShader.setFloat("totalWidth", 1035);
-    brdShader.setFloat("totalHeight", 899);
+    // Tell the shader program how big the full set of game boards is
+    brdShader.setFloat("totalWidth", brdWidth*tileCols);
+    brdShader.setFloat("totalHeight", brdHeight*tileRows);
 
-    /*
-     * The most important part of this OpenGL pipeline is the vertex array object,
-     * which manages the position and texture attributes of the vertices and sets
-     * the order in which the vertices should be drawn to form a square. All of 
-     * the objects that are drawn are drawn as squares made from two triangle
-     * primitives. The array consists of a vertex buffer object to hold the data,
-     * a set of attribute pointers to parse the data, and an element buffer object
-     * to draw the four vertices in the correct order to from the triangle pair. 
-     */
-
-    glGenVertexArrays(1, &sqrArray);
-    glBindVertexArray(sqrArray);
-
-    glGenBuffers(1, &sqrBuffer); // Stores vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, sqrBuffer);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); // Pixel Position
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float))); // Texture coordinates
-    glEnableVertexAttribArray(0); // Sets location = 0 to the pixle position in the shader code
-    glEnableVertexAttribArray(1); // Sets location = 1 to the texture coordinates in the shader code
-    
-    std::vector<unsigned int> sqrIndices = { // Maps four source vertices to the six triangle vertices needed to draw a square
-        0, 1, 2, // Vertices of triangle 1
-        1, 2, 3};  // Vertices of triangle 2
-    glGenBuffers(1, &sqrIndexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sqrIndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sqrIndices.size() * sizeof(unsigned int), &sqrIndices[0], GL_STATIC_DRAW);
-    
-    // Create the textures associated with the game board, font, and blocks
-    createTexture(brdTexture, location + std::string("/images/tetrisboard.png"));
-    createTexture(fontTexture, location + std::string("/images/fontbitmap.png"));
-    createTexture(blockTextures[0], location + std::string("/images/yellowblock.png"));
-    createTexture(blockTextures[1], location + std::string("/images/redblock.png"));
-    createTexture(blockTextures[2], location + std::string("/images/whiteblock.png"));
-    createTexture(blockTextures[3], location + std::string("/images/allowedblock.png"));
-    createTexture(blockTextures[4], location + std::string("/images/disallowedblock.png"));
+    // Pack the images associated with the game board, font, and blocks into the atlas
+    brdImage = atlas.addImage(location + std::string("/images/tetrisboard.png"));
+    fontImage = atlas.addImage(location + std::string("/images/fontbitmap.png"));
+    blockImages[0] = atlas.addImage(location + std::string("/images/yellowblock.png"));
+    blockImages[1] = atlas.addImage(location + std::string("/images/redblock.png"));
+    blockImages[2] = atlas.addImage(location + std::string("/images/whiteblock.png"));
+    blockImages[3] = atlas.addImage(location + std::string("/images/allowedblock.png"));
+    blockImages[4] = atlas.addImage(location + std::string("/images/disallowedblock.png"));
+    atlas.build();
 }
 
 BoardDrawer::~BoardDrawer()
 /*
- * The class destructor tells OpenGL to free up all memory associated with the 
- * textures and buffer objects that were created.
+ * The OpenGL objects are owned by the atlas and the batch, which free them
+ * when they are destroyed.
  */
-{
-    glDeleteTextures(1, &brdTexture);
-    glDeleteTextures(1, &fontTexture);
-    glDeleteTextures(blockTextures.size(), &blockTextures[0]);
-    glDeleteBuffers(1, &sqrBuffer);
-    glDeleteBuffers(1, &sqrIndexBuffer);
-    glDeleteVertexArrays(1, &sqrArray);
-}
+{}
 
 void BoardDrawer::drawFrame()
 /*
  * This function is simply a convenient way of calling all of the
  * member functions that draw each part of the game. The order of
  * the function calls is arbitrary except that the board must be
- * drawn first.   
+ * drawn first. When boards are tiled, each one is queued in turn with
+ * the origin shifted to its tile, filling the window row by row from the
+ * top left. The member functions only queue their squares, and the 
+ * whole frame is then drawn at once by flushing the batch.
  */
 {
-    drawBoard(); // Must be called first
-    drawPieceBlocks();
-    drawPreview();
-    drawLineCount();
-    drawLineTypeCount();
-    drawScore();
-    drawLevel();
+    for (int tile = 0; tile < static_cast<int>(boards.size()); ++tile) {
+        const BoardSources& sources = boards[tile];
+        originX = (tile % tileCols)*brdWidth;
+        originY = (tile / tileCols)*brdHeight;
+        drawBoard(); // Must be called first
+        drawPieceBlocks(sources.grid);
+        drawPreview(sources.nextPiece);
+        drawLineCount(sources.lineCount);
+        drawLineTypeCount(sources.lineTypeCount);
+        drawScore(sources.score);
+        drawLevel(sources.level);
+    }
+    brdShader.use();
+    atlas.bind();
+    batch.flush();
 }
 
 void BoardDrawer::drawBoard()
@@ -140,10 +124,10 @@ void BoardDrawer::drawBoard()
  * of the NES board texture image. 
  */ 
 {
-    drawSquare(brdVertices, brdTexture);
+    drawSquare(brdVertices, brdImage);
 }
 
-void BoardDrawer::drawPreview()
+void BoardDrawer::drawPreview(const Piece* nextPiece)
 /*
  * This functions draws the piece preview which allows the player to see which
  * piece is coming next. The main difficulty comes from using the coordinate
@@ -152,9 +136,10 @@ void BoardDrawer::drawPreview()
  * described below.
  */
 {
-    if (nextPieceSource) {
-        const PieceData& data  = (*nextPieceSource)->data;
-        int texture = blockTextures[pieceTexMap[data.index]];
+    if (nextPiece) {
+        const PieceData& data  = *(nextPiece->data);
+        const PieceCoords& offsets = data.coordOffsets[0];
+        int image = blockImages[pieceTexMap[data.index]];
 
         /*
          * The first step is to find the height and width of the 
@@ -162,23 +147,23 @@ void BoardDrawer::drawPreview()
          * the most negative offset and most positive offset for both
          * the x and y coordinates.
          */
-        int minHeight = data.coordOffsets[0][0][0];  
-        int maxHeight = data.coordOffsets[0][0][0];
-        int minWidth = data.coordOffsets[0][0][1]; 
-        int maxWidth = data.coordOffsets[0][0][1];  
+        int minHeight = offsets[0].first;  
+        int maxHeight = offsets[0].first;
+        int minWidth = offsets[0].second; 
+        int maxWidth = offsets[0].second;  
 
-        for (auto& rowCol : data.coordOffsets[0]) {
-            if (rowCol[0] < minHeight) {
-                minHeight = rowCol[0];
+        for (auto& rowCol : offsets) {
+            if (rowCol.first < minHeight) {
+                minHeight = rowCol.first;
             }
-            if (rowCol[0] > maxHeight) {
-                maxHeight = rowCol[0];
+            if (rowCol.first > maxHeight) {
+                maxHeight = rowCol.first;
             }
-            if (rowCol[1] < minWidth) {
-                minWidth = rowCol[1];
+            if (rowCol.second < minWidth) {
+                minWidth = rowCol.second;
             }
-            if (rowCol[1] > maxWidth) {
-                maxWidth = rowCol[1];
+            if (rowCol.second > maxWidth) {
+                maxWidth = rowCol.second;
             }
         }
 
@@ -210,72 +195,66 @@ void BoardDrawer::drawPreview()
         /*
          * With the spacing, which converts the grid coordinates to pixel coordinates, and
          * the the offsets needed to center the piece, the vertices are easily created by
-         * iterating through the coordOffsets and applying the affine transformation. The
+         * iterating through the offsets and applying the affine transformation. The
          * blocks are then drawn individually. 
          */
-        for (auto& rowCol : data.coordOffsets[0]) {
-            const float x0 = rowCol[1]*spacing + widthOffset;
-            const float x1 = (rowCol[1] + 1)*spacing + widthOffset;
-            const float y0 = -rowCol[0]*spacing + heightOffset;
-            const float y1 = -(rowCol[0] + 1)*spacing + heightOffset;
-            std::vector<float> vertices = {
-            x0, y1,      0, 1,
-            x1, y1,      1, 1,
-            x0, y0,      0, 0,
-            x1, y0,      1, 0};
-            drawSquare(vertices, texture);
+        for (auto& rowCol : offsets) {
+            const float x0 = rowCol.second*spacing + widthOffset;
+            const float x1 = (rowCol.second + 1)*spacing + widthOffset;
+            const float y0 = -rowCol.first*spacing + heightOffset;
+            const float y1 = -(rowCol.first + 1)*spacing + heightOffset;
+            drawSquare(x0, y1, x1, y0, image);
         }
     }
 }
 
-void BoardDrawer::drawPieceBlocks() {
+void BoardDrawer::drawPieceBlocks(const Grid* grid) {
     /*
      * This function draws the blocks in the playfield that are filled. It does
-     * this by getting the filled blocks from the target Grid and calculatng 
+     * this by walking the occupancy masks of the target Grid and calculatng 
      * their pixel positions by starting from the bottom left corner of the
      * playfield and adding the correct amount of spacing based on the grid
-     * coordinates. 
+     * coordinates. The masks are read directly so that drawing many boards
+     * does not allocate. 
      */
-    if (gridSource) {
-        for (auto& rowColIndex : gridSource->getFilledBlocks()) {
-            int row = rowColIndex[0];
-            int col = rowColIndex[1];
-            int index = rowColIndex[2];
-            int texture = blockTextures[pieceTexMap[index]];
-            const float x0 = playFieldPos[0] + col*blockWidthSpacing;
-            const float x1 = playFieldPos[0] + (col + 1)*blockWidthSpacing;
-            const float y0 = playFieldPos[5] - row*blockHeightSpacing;
-            const float y1 = playFieldPos[5] - (row + 1)*blockHeightSpacing;
-            std::vector<float> vertices = {
-            x0, y1,      0, 1,
-            x1, y1,      1, 1,
-            x0, y0,      0, 0,
-            x1, y0,      1, 0};
-            drawSquare(vertices, texture);
+    if (grid) {
+        for (int row = 0; row < grid->height; ++row) {
+            uint16_t mask = grid->rows[row];
+            for (int col = 0; mask; ++col, mask >>= 1) {
+                if (mask & 1) {
+                    int index = grid->colors[row*Grid::maxWidth + col];
+                    int image = blockImages[pieceTexMap[index]];
+                    const float x0 = playFieldPos[0] + col*blockWidthSpacing;
+                    const float x1 = playFieldPos[0] + (col + 1)*blockWidthSpacing;
+                    const float y0 = playFieldPos[5] - row*blockHeightSpacing;
+                    const float y1 = playFieldPos[5] - (row + 1)*blockHeightSpacing;
+                    drawSquare(x0, y1, x1, y0, image);
+                }
+            }
         }
     }
 }
 
-void BoardDrawer::drawLineCount()
+void BoardDrawer::drawLineCount(const int* lineCount)
 /*
  * This function draws the line count of the game, formatting it as
  * "LINES-XXX" where at least three digit is always displayed. 
  */
 {
-    if (lineCountSource) {
+    if (lineCount) {
         int x0 = 408, x1 = 695;
         int y0 = 64, y1 = 95;
-        std::string lineCountRaw = std::to_string(*lineCountSource);
+        std::string lineCountRaw = std::to_string(*lineCount);
         std::string lineCountStr = std::string("lines-") + 
             (lineCountRaw.size() < 3 ? std::string(3 - lineCountRaw.size(), '0') + lineCountRaw : lineCountRaw);
         auto textVertices = textDrawer.getTextVertices(lineCountStr, x0, x1, y0, y1);
         for (auto& charVertices : textVertices) {
-            drawSquare(charVertices, fontTexture);
+            drawSquare(charVertices, fontImage);
         }
     }
 }
 
-void BoardDrawer::drawLineTypeCount()
+void BoardDrawer::drawLineTypeCount(const std::vector<int>* lineTypeCount)
 /*
  * This function draws the counters for the different types of line clears,
  * displaying at least three digits in each counter. The different counters
@@ -283,12 +262,12 @@ void BoardDrawer::drawLineTypeCount()
  * the same 
  */
 {
-    if (lineTypeCountSource) {
+    if (lineTypeCount) {
         int x0 = 68, x1 = 333;
         int yStart = 630; // Height from which to start drawing the stack of counters
         int type = 0; // Keeps track of the line clear type during drawing loop
         std::vector<std::string> typeLabels{"single - ", "double - ", "triple - ", "tetris - "};
-        for (const auto& typeCount : *lineTypeCountSource) {
+        for (const auto& typeCount : *lineTypeCount) {
             int y0 = yStart + 50*type; // Starting height changes along the stack
             int y1 = yStart + 50*type + 18; // The text is 18 pixels tall
             std::string countRaw = std::to_string(typeCount);
@@ -296,99 +275,118 @@ void BoardDrawer::drawLineTypeCount()
                 (countRaw.size() < 3 ? std::string(3 - countRaw.size(), '0') + countRaw : countRaw);
             auto textVertices = textDrawer.getTextVertices(countStr, x0, x1, y0, y1);
             for (auto& charVertices : textVertices) { // Draw each character of the string
-                drawSquare(charVertices, fontTexture);
+                drawSquare(charVertices, fontImage);
             }
             ++type;
         }
     }
 }
 
-void BoardDrawer::drawScore()
+void BoardDrawer::drawScore(const int* score)
 /*
  * This function draws the score of the game. It always displays at least eight 
  * digits.
  */
 {
-    if (scoreSource) {
+    if (score) {
         int x0 = 774, x1 = 980;
         int y0 = 258, y1 = 286;
-        std::string scoreRaw = std::to_string(*scoreSource);
+        std::string scoreRaw = std::to_string(*score);
         std::string scoreStr = scoreRaw.size() < 6 ? std::string(6 - scoreRaw.size(), '0') + scoreRaw : scoreRaw;
         auto textVertices = textDrawer.getTextVertices(scoreStr, x0, x1, y0, y1);
         for (auto& charVertices : textVertices) {
-            drawSquare(charVertices, fontTexture);
+            drawSquare(charVertices, fontImage);
         }
     }
 }
 
-void BoardDrawer::drawLevel()
+void BoardDrawer::drawLevel(const int* level)
 /*
  * This function draws the level counter of the game. It always displays at
  * least two digits.
  */
 {
-    if (levelSource) {
+    if (level) {
         int x0 = 843, x1 = 902;
         int y0 = 642, y1 = 671;
-        std::string levelRaw = std::to_string(*levelSource);
+        std::string levelRaw = std::to_string(*level);
         std::string levelStr = levelRaw.size() < 2 ? std::string(2 - levelRaw.size(), '0') + levelRaw : levelRaw;
         auto textVertices = textDrawer.getTextVertices(levelStr, x0, x1, y0, y1);
         for (auto& charVertices : textVertices) {
-            drawSquare(charVertices, fontTexture);
+            drawSquare(charVertices, fontImage);
         }
     }
 }
 
+void BoardDrawer::assignBoard(int tile, const BoardSources& sources)
+/*
+ * Assign all of the data sources of one tile at once. The tiles are numbered
+ * row by row from the top left, and the single-board assign functions below
+ * all refer to tile 0. Out-of-range tiles are ignored.
+ */
+{
+    if (tile >= 0 && tile < static_cast<int>(boards.size())) {
+        boards[tile] = sources;
+    }
+}
+
 void BoardDrawer::assignGrid(Grid& grid)
 // Assign source of grid data
 {
-    gridSource = &grid;
+    boards[0].grid = &grid;
 }
 
 void BoardDrawer::assignLevel(int& level)
 // Assign source of level data
 {
-    levelSource = &level;
+    boards[0].level = &level;
 }
 
 void BoardDrawer::assignLineCount(int& lineCount)
 // Assign source of line count data
 {
-    lineCountSource = &lineCount;
+    boards[0].lineCount = &lineCount;
 }
 
 void BoardDrawer::assignlineTypeCount(std::vector<int>& typecounts)
 // Assign source of line type data
 {
-    lineTypeCountSource = &typecounts;
+    boards[0].lineTypeCount = &typecounts;
 }
 
-void BoardDrawer::assignNextPiece(std::unique_ptr<Piece>& piecePtr)
+void BoardDrawer::assignNextPiece(Piece& piece)
 // Assign source of piece preview data
 {
-    nextPieceSource = &piecePtr;
+    boards[0].nextPiece = &piece;
 }
 
 void BoardDrawer::assignScore(int& score)
 // Assign source of score data
 {
-    scoreSource = &score;
+    boards[0].score = &score;
 }
 
-void BoardDrawer::drawSquare(const std::vector<float>& vertices, unsigned int texture)
+void BoardDrawer::drawSquare(const std::vector<float>& vertices, int image)
 /*
- * This function is the one that does all of the actual drawing, since
- * all of the primitives that need to be drawn are squares. To the process
- * simply involes binding the passed texture, binding and loading the vertex
- * array buffer, attaching the shader program, and then drawing the square
- * as a pair of triangles. 
+ * This function is the one that all of the drawing goes through, since
+ * all of the primitives that need to be drawn are squares. The square is 
+ * not drawn immediately, but is instead queued in the batch along with the
+ * region of the atlas that holds the passed image. The square is shifted to
+ * the origin of the board currently being drawn.
  */
 {
-    glBindTexture(GL_TEXTURE_2D, texture);
-    brdShader.use();
-    glBindVertexArray(sqrArray);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    batch.addQuad(vertices, atlas.getRegion(image), originX, originY);
+}
+
+void BoardDrawer::drawSquare(float left, float top, float right, float bottom, int image)
+/*
+ * This overload queues a square that shows the whole of the passed image,
+ * which avoids building a vertex vector for each of the many block squares.
+ */
+{
+    const AtlasRegion region = atlas.getRegion(image);
+    batch.addQuad(originX + left, originY + top, originX + right, originY + bottom,
+        region.u0, region.v1, region.u1, region.v0);
 }
 
 void createTexture(unsigned int& texID, std::string filePath)
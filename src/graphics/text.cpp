@@ -85,6 +85,7 @@ std::vector<std::vector<float>> TextDrawer::getTextVertices(std::string text, fl
     // Iterate through each character and generate a set of four vertices to use when drawing
     float charCount = 0;
     std::vector<std::vector<float>> textVertices;
+    textVertices.reserve(text.length());
     for (auto& c : text) {
         // The x-coordinates of each character are generated from the horizontal spacing
         float x0Char = x0 + horiz_spacing*charCount;